@@ -23,6 +23,7 @@
 
 #include <stddef.h>
 
+#include "vkd3d_atomic.h"
 #include "vkd3d_memory.h"
 
 enum hash_map_entry_flag
@@ -203,6 +204,240 @@ static inline void hash_map_clear(struct hash_map *hash_map)
     hash_map->used_count = 0;
 }
 
+/* Removes all entries, but keeps the allocation around for reuse. */
+static inline void hash_map_reset(struct hash_map *hash_map)
+{
+    if (hash_map->used_count)
+        memset(hash_map->entries, 0, hash_map->entry_count * hash_map->entry_size);
+    hash_map->used_count = 0;
+}
+
+/* Insert-only open-addressing hash table. Lookups do not need any locking
+ * and can run concurrently with inserts, which must be serialized by the
+ * caller. Entries are published by setting the occupied flag last. Tables
+ * that get replaced when growing are retired rather than freed so that
+ * readers never access freed memory, and since tables grow geometrically,
+ * all retired tables together are smaller than the current table. Callers
+ * which know that no reader is active may free retired tables early. */
+struct concurrent_hash_map_table
+{
+    struct concurrent_hash_map_table *retired;
+    void *entries;
+    uint32_t entry_count;
+    uint32_t used_count;
+};
+
+struct concurrent_hash_map
+{
+    pfn_hash_func hash_func;
+    pfn_hash_compare_func compare_func;
+    size_t entry_size;
+    struct concurrent_hash_map_table *table;
+};
+
+static inline struct hash_map_entry *concurrent_hash_map_table_get_entry(const struct concurrent_hash_map *hash_map,
+        const struct concurrent_hash_map_table *table, uint32_t entry_idx)
+{
+    return void_ptr_offset(table->entries, hash_map->entry_size * entry_idx);
+}
+
+typedef bool (*pfn_hash_keep_func)(const struct hash_map_entry *entry);
+
+static inline bool concurrent_hash_map_replace_table(struct concurrent_hash_map *hash_map,
+        uint32_t entry_count, pfn_hash_keep_func keep_func)
+{
+    struct concurrent_hash_map_table *old_table, *new_table;
+    uint32_t i, entry_idx;
+
+    old_table = hash_map->table;
+
+    if (!(new_table = vkd3d_malloc(sizeof(*new_table))))
+        return false;
+
+    new_table->entry_count = entry_count;
+    new_table->used_count = 0;
+    new_table->retired = old_table;
+
+    if (!(new_table->entries = vkd3d_calloc(new_table->entry_count, hash_map->entry_size)))
+    {
+        vkd3d_free(new_table);
+        return false;
+    }
+
+    for (i = 0; old_table && i < old_table->entry_count; i++)
+    {
+        struct hash_map_entry *old_entry = concurrent_hash_map_table_get_entry(hash_map, old_table, i);
+        struct hash_map_entry *new_entry;
+
+        if (!(old_entry->flags & HASH_MAP_ENTRY_OCCUPIED) || (keep_func && !keep_func(old_entry)))
+            continue;
+
+        entry_idx = old_entry->hash_value % new_table->entry_count;
+        new_entry = concurrent_hash_map_table_get_entry(hash_map, new_table, entry_idx);
+
+        while (new_entry->flags & HASH_MAP_ENTRY_OCCUPIED)
+        {
+            entry_idx = entry_idx + 1 < new_table->entry_count ? entry_idx + 1 : 0;
+            new_entry = concurrent_hash_map_table_get_entry(hash_map, new_table, entry_idx);
+        }
+
+        /* The new table is not visible to readers yet */
+        memcpy(new_entry, old_entry, hash_map->entry_size);
+        new_table->used_count += 1;
+    }
+
+    /* Sequentially consistent, so that callers can tell whether a reader
+     * may still see a retired table by checking a reader count afterwards. */
+    vkd3d_atomic_ptr_store_explicit(&hash_map->table, new_table, vkd3d_memory_order_seq_cst);
+    return true;
+}
+
+static inline bool concurrent_hash_map_grow(struct concurrent_hash_map *hash_map)
+{
+    return concurrent_hash_map_replace_table(hash_map,
+            hash_map_next_size(hash_map->table ? hash_map->table->entry_count : 0), NULL);
+}
+
+/* Replaces the table with one that only contains the entries accepted by keep_func,
+ * which lets callers drop entries they no longer need. The old table is retired. */
+static inline bool concurrent_hash_map_compact(struct concurrent_hash_map *hash_map, pfn_hash_keep_func keep_func)
+{
+    uint32_t i, keep_count = 0, entry_count = 0;
+    const struct concurrent_hash_map_table *table;
+
+    if (!(table = hash_map->table))
+        return true;
+
+    for (i = 0; i < table->entry_count; i++)
+    {
+        const struct hash_map_entry *entry = concurrent_hash_map_table_get_entry(hash_map, table, i);
+
+        if ((entry->flags & HASH_MAP_ENTRY_OCCUPIED) && keep_func(entry))
+            keep_count++;
+    }
+
+    /* Leave room for the table to double before it has to grow again */
+    do
+    {
+        entry_count = hash_map_next_size(entry_count);
+    } while (10 * 2 * keep_count >= 7 * entry_count);
+
+    return concurrent_hash_map_replace_table(hash_map, entry_count, keep_func);
+}
+
+/* Frees all retired tables. Callers must ensure that no reader can still access them. */
+static inline void concurrent_hash_map_free_retired(struct concurrent_hash_map *hash_map)
+{
+    struct concurrent_hash_map_table *table, *retired;
+
+    if (!hash_map->table)
+        return;
+
+    for (table = hash_map->table->retired; table; table = retired)
+    {
+        retired = table->retired;
+        vkd3d_free(table->entries);
+        vkd3d_free(table);
+    }
+
+    hash_map->table->retired = NULL;
+}
+
+static inline struct hash_map_entry *concurrent_hash_map_find(const struct concurrent_hash_map *hash_map, const void *key)
+{
+    const struct concurrent_hash_map_table *table;
+    uint32_t hash_value, entry_idx;
+
+    if (!(table = vkd3d_atomic_ptr_load_explicit(&hash_map->table, vkd3d_memory_order_seq_cst)))
+        return NULL;
+
+    hash_value = hash_map->hash_func(key);
+    entry_idx = hash_value % table->entry_count;
+
+    /* Tables are never completely populated, so this is guaranteed to return.
+     * Entries inserted after a table got retired are missed, in which case
+     * callers have to look up the entry again while holding the lock. */
+    while (true)
+    {
+        struct hash_map_entry *entry = concurrent_hash_map_table_get_entry(hash_map, table, entry_idx);
+
+        if (!(vkd3d_atomic_uint32_load_explicit(&entry->flags, vkd3d_memory_order_acquire) & HASH_MAP_ENTRY_OCCUPIED))
+            return NULL;
+
+        if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
+            return entry;
+
+        entry_idx = entry_idx + 1 < table->entry_count ? entry_idx + 1 : 0;
+    }
+}
+
+static inline struct hash_map_entry *concurrent_hash_map_insert(struct concurrent_hash_map *hash_map,
+        const void *key, const struct hash_map_entry *entry)
+{
+    struct concurrent_hash_map_table *table = hash_map->table;
+    struct hash_map_entry *target = NULL;
+    uint32_t hash_value, entry_idx;
+
+    if (!table || 10 * table->used_count >= 7 * table->entry_count)
+    {
+        if (!concurrent_hash_map_grow(hash_map))
+            return NULL;
+
+        table = hash_map->table;
+    }
+
+    hash_value = hash_map->hash_func(key);
+    entry_idx = hash_value % table->entry_count;
+
+    while (!target)
+    {
+        struct hash_map_entry *current = concurrent_hash_map_table_get_entry(hash_map, table, entry_idx);
+
+        if (!(current->flags & HASH_MAP_ENTRY_OCCUPIED) ||
+                (current->hash_value == hash_value && hash_map->compare_func(key, current)))
+            target = current;
+        else
+            entry_idx = entry_idx + 1 < table->entry_count ? entry_idx + 1 : 0;
+    }
+
+    if (!(target->flags & HASH_MAP_ENTRY_OCCUPIED))
+    {
+        /* Readers may look at the entry as soon as the occupied flag is set */
+        memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
+        target->hash_value = hash_value;
+        vkd3d_atomic_uint32_store_explicit(&target->flags, HASH_MAP_ENTRY_OCCUPIED, vkd3d_memory_order_release);
+        table->used_count += 1;
+    }
+
+    /* If target is occupied, we already have an entry in the hashmap.
+     * Return old one, caller is responsible for cleaning up the node we attempted to add. */
+
+    return target;
+}
+
+static inline void concurrent_hash_map_init(struct concurrent_hash_map *hash_map,
+        pfn_hash_func hash_func, pfn_hash_compare_func compare_func, size_t entry_size)
+{
+    hash_map->hash_func = hash_func;
+    hash_map->compare_func = compare_func;
+    hash_map->entry_size = entry_size;
+    hash_map->table = NULL;
+}
+
+static inline void concurrent_hash_map_clear(struct concurrent_hash_map *hash_map)
+{
+    struct concurrent_hash_map_table *table, *retired;
+
+    for (table = hash_map->table; table; table = retired)
+    {
+        retired = table->retired;
+        vkd3d_free(table->entries);
+        vkd3d_free(table);
+    }
+
+    hash_map->table = NULL;
+}
+
 static inline uint32_t hash_combine(uint32_t old_hash, uint32_t new_hash) {
     return old_hash ^ (new_hash + 0x9e3779b9 + (old_hash << 6) + (old_hash >> 2));
 }
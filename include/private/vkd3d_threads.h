@@ -192,4 +192,18 @@ static inline unsigned int vkd3d_get_current_thread_id(void)
 #endif
 }
 
+static inline unsigned int vkd3d_get_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#elif defined(__linux__)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+#else
+    return 1;
+#endif
+}
+
 #endif /* __VKD3D_THREADS_H */
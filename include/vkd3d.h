@@ -67,7 +67,9 @@ enum vkd3d_config_flags
     VKD3D_CONFIG_FLAG_DXR = 0x00000010,
     VKD3D_CONFIG_FLAG_SINGLE_QUEUE = 0x00000020,
     VKD3D_CONFIG_FLAG_FORCE_TGSM_BARRIERS = 0x00000040,
-    VKD3D_CONFIG_FLAG_DESCRIPTOR_QA_CHECKS = 0x00000080
+    VKD3D_CONFIG_FLAG_DESCRIPTOR_QA_CHECKS = 0x00000080,
+    VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER = 0x00000100,
+    VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE = 0x00000200
 };
 
 typedef HRESULT (*PFN_vkd3d_signal_event)(HANDLE event);
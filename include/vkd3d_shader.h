@@ -52,6 +52,8 @@ enum vkd3d_shader_visibility
     VKD3D_FORCE_32_BIT_ENUM(VKD3D_SHADER_VISIBILITY),
 };
 
+/* Bumped whenever the hash function changes, which also changes dump and override file names. */
+#define VKD3D_SHADER_HASH_VERSION 2
 typedef uint64_t vkd3d_shader_hash_t;
 
 struct vkd3d_shader_meta
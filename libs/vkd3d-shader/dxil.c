@@ -497,7 +497,7 @@ int vkd3d_shader_compile_dxil(const struct vkd3d_shader_code *dxbc,
     hash = vkd3d_shader_hash(dxbc);
     spirv->meta.replaced = false;
     spirv->meta.hash = hash;
-    if (vkd3d_shader_replace(hash, &spirv->code, &spirv->size))
+    if (vkd3d_shader_replace(dxbc, hash, &spirv->code, &spirv->size))
     {
         spirv->meta.replaced = true;
         return ret;
@@ -826,7 +826,7 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
     demangled_export = vkd3d_dup_demangled_entry_point_ascii(export);
     if (demangled_export)
     {
-        if (vkd3d_shader_replace_export(hash, &spirv->code, &spirv->size, demangled_export))
+        if (vkd3d_shader_replace_export(dxil, hash, &spirv->code, &spirv->size, demangled_export))
         {
             spirv->meta.replaced = true;
             vkd3d_free(demangled_export);
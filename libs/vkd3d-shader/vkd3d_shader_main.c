@@ -19,6 +19,8 @@
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_SHADER
 
 #include "vkd3d_shader_private.h"
+#include "vkd3d_threads.h"
+#include "vkd3d_build.h"
 
 #include <stdio.h>
 #include <inttypes.h>
@@ -78,9 +80,13 @@ err:
     return false;
 }
 
-bool vkd3d_shader_replace(vkd3d_shader_hash_t hash, const void **data, size_t *size)
+static vkd3d_shader_hash_t vkd3d_shader_hash_legacy(const struct vkd3d_shader_code *shader);
+
+bool vkd3d_shader_replace(const struct vkd3d_shader_code *shader, vkd3d_shader_hash_t hash,
+        const void **data, size_t *size)
 {
     static bool enabled = true;
+    vkd3d_shader_hash_t legacy_hash;
     char filename[1024];
     const char *path;
 
@@ -94,12 +100,20 @@ bool vkd3d_shader_replace(vkd3d_shader_hash_t hash, const void **data, size_t *s
     }
 
     snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".spv", path, hash);
-    return vkd3d_shader_replace_path(filename, hash, data, size);
+    if (vkd3d_shader_replace_path(filename, hash, data, size))
+        return true;
+
+    /* Keep picking up overrides which were named with the version 1 hash. */
+    legacy_hash = vkd3d_shader_hash_legacy(shader);
+    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".spv", path, legacy_hash);
+    return vkd3d_shader_replace_path(filename, legacy_hash, data, size);
 }
 
-bool vkd3d_shader_replace_export(vkd3d_shader_hash_t hash, const void **data, size_t *size, const char *export)
+bool vkd3d_shader_replace_export(const struct vkd3d_shader_code *shader, vkd3d_shader_hash_t hash,
+        const void **data, size_t *size, const char *export)
 {
     static bool enabled = true;
+    vkd3d_shader_hash_t legacy_hash;
     char filename[1024];
     const char *path;
 
@@ -113,7 +127,12 @@ bool vkd3d_shader_replace_export(vkd3d_shader_hash_t hash, const void **data, si
     }
 
     snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".lib.%s.spv", path, hash, export);
-    return vkd3d_shader_replace_path(filename, hash, data, size);
+    if (vkd3d_shader_replace_path(filename, hash, data, size))
+        return true;
+
+    legacy_hash = vkd3d_shader_hash_legacy(shader);
+    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".lib.%s.spv", path, legacy_hash, export);
+    return vkd3d_shader_replace_path(filename, legacy_hash, data, size);
 }
 
 void vkd3d_shader_dump_shader(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader, const char *ext)
@@ -319,7 +338,7 @@ static int vkd3d_shader_validate_shader_type(enum vkd3d_shader_type type, VkShad
     return 0;
 }
 
-int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
+static int vkd3d_shader_compile_sm4(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_shader_code *spirv, unsigned int compiler_options,
         const struct vkd3d_shader_interface_info *shader_interface_info,
         const struct vkd3d_shader_compile_arguments *compile_args)
@@ -331,22 +350,10 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
     vkd3d_shader_hash_t hash;
     int ret;
 
-    TRACE("dxbc {%p, %zu}, spirv %p, compiler_options %#x, shader_interface_info %p, compile_args %p.\n",
-            dxbc->code, dxbc->size, spirv, compiler_options, shader_interface_info, compile_args);
-
-    if ((ret = vkd3d_shader_validate_compile_args(compile_args)) < 0)
-        return ret;
-
-    /* DXIL is handled externally through dxil-spirv. */
-    if (shader_is_dxil(dxbc->code, dxbc->size))
-    {
-        return vkd3d_shader_compile_dxil(dxbc, spirv, shader_interface_info, compile_args);
-    }
-
     hash = vkd3d_shader_hash(dxbc);
     spirv->meta.replaced = false;
     spirv->meta.hash = hash;
-    if (vkd3d_shader_replace(hash, &spirv->code, &spirv->size))
+    if (vkd3d_shader_replace(dxbc, hash, &spirv->code, &spirv->size))
     {
         spirv->meta.replaced = true;
         return VKD3D_OK;
@@ -416,6 +423,40 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
     return ret;
 }
 
+int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_shader_code *spirv, unsigned int compiler_options,
+        const struct vkd3d_shader_interface_info *shader_interface_info,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    struct vkd3d_shader_cache_key cache_key;
+    bool use_cache;
+    int ret;
+
+    TRACE("dxbc {%p, %zu}, spirv %p, compiler_options %#x, shader_interface_info %p, compile_args %p.\n",
+            dxbc->code, dxbc->size, spirv, compiler_options, shader_interface_info, compile_args);
+
+    if ((ret = vkd3d_shader_validate_compile_args(compile_args)) < 0)
+        return ret;
+
+    if ((use_cache = vkd3d_shader_cache_enabled()))
+    {
+        vkd3d_shader_cache_key_init(&cache_key, dxbc, compiler_options, shader_interface_info, compile_args);
+        if (vkd3d_shader_cache_load(&cache_key, spirv))
+            return VKD3D_OK;
+    }
+
+    /* DXIL is handled externally through dxil-spirv. */
+    if (shader_is_dxil(dxbc->code, dxbc->size))
+        ret = vkd3d_shader_compile_dxil(dxbc, spirv, shader_interface_info, compile_args);
+    else
+        ret = vkd3d_shader_compile_sm4(dxbc, spirv, compiler_options, shader_interface_info, compile_args);
+
+    if (ret == VKD3D_OK && use_cache && !spirv->meta.replaced)
+        vkd3d_shader_cache_store(&cache_key, spirv);
+
+    return ret;
+}
+
 static bool vkd3d_shader_instruction_is_uav_read(const struct vkd3d_shader_instruction *instruction)
 {
     enum VKD3D_SHADER_INSTRUCTION_HANDLER handler_idx = instruction->handler_idx;
@@ -736,7 +777,8 @@ void vkd3d_shader_free_shader_signature(struct vkd3d_shader_signature *signature
     signature->elements = NULL;
 }
 
-vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader)
+/* Version 1 of the shader hash, byte-wise FNV-1a. */
+static vkd3d_shader_hash_t vkd3d_shader_hash_legacy(const struct vkd3d_shader_code *shader)
 {
     vkd3d_shader_hash_t h = 0xcbf29ce484222325ull;
     const uint8_t *code = shader->code;
@@ -747,3 +789,411 @@ vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader)
 
     return h;
 }
+
+#define VKD3D_SHADER_HASH_PRIME1 0x9e3779b185ebca87ull
+#define VKD3D_SHADER_HASH_PRIME2 0xc2b2ae3d27d4eb4full
+#define VKD3D_SHADER_HASH_PRIME3 0x165667b19e3779f9ull
+#define VKD3D_SHADER_HASH_PRIME4 0x85ebca77c2b2ae63ull
+#define VKD3D_SHADER_HASH_PRIME5 0x27d4eb2f165667c5ull
+
+static inline uint64_t vkd3d_shader_hash_rotl(uint64_t v, unsigned int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t vkd3d_shader_hash_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t vkd3d_shader_hash_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t vkd3d_shader_hash_round(uint64_t acc, uint64_t input)
+{
+    acc += input * VKD3D_SHADER_HASH_PRIME2;
+    acc = vkd3d_shader_hash_rotl(acc, 31);
+    return acc * VKD3D_SHADER_HASH_PRIME1;
+}
+
+static inline uint64_t vkd3d_shader_hash_merge(uint64_t acc, uint64_t lane)
+{
+    acc ^= vkd3d_shader_hash_round(0, lane);
+    return acc * VKD3D_SHADER_HASH_PRIME1 + VKD3D_SHADER_HASH_PRIME4;
+}
+
+/* Version 2 of the shader hash, XXH64 with a zero seed. Consumes 32 bytes per
+ * iteration over four independent lanes, which is an order of magnitude faster
+ * than FNV-1a on large DXIL libraries. Assumes a little-endian host. */
+vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader)
+{
+    const uint8_t *code = shader->code;
+    const uint8_t *end = code + shader->size;
+    uint64_t v1, v2, v3, v4, h;
+
+    if (shader->size >= 32)
+    {
+        v1 = VKD3D_SHADER_HASH_PRIME1 + VKD3D_SHADER_HASH_PRIME2;
+        v2 = VKD3D_SHADER_HASH_PRIME2;
+        v3 = 0;
+        v4 = -VKD3D_SHADER_HASH_PRIME1;
+
+        do
+        {
+            v1 = vkd3d_shader_hash_round(v1, vkd3d_shader_hash_read64(code + 0));
+            v2 = vkd3d_shader_hash_round(v2, vkd3d_shader_hash_read64(code + 8));
+            v3 = vkd3d_shader_hash_round(v3, vkd3d_shader_hash_read64(code + 16));
+            v4 = vkd3d_shader_hash_round(v4, vkd3d_shader_hash_read64(code + 24));
+            code += 32;
+        } while (end - code >= 32);
+
+        h = vkd3d_shader_hash_rotl(v1, 1) + vkd3d_shader_hash_rotl(v2, 7) +
+                vkd3d_shader_hash_rotl(v3, 12) + vkd3d_shader_hash_rotl(v4, 18);
+        h = vkd3d_shader_hash_merge(h, v1);
+        h = vkd3d_shader_hash_merge(h, v2);
+        h = vkd3d_shader_hash_merge(h, v3);
+        h = vkd3d_shader_hash_merge(h, v4);
+    }
+    else
+        h = VKD3D_SHADER_HASH_PRIME5;
+
+    h += shader->size;
+
+    while (end - code >= 8)
+    {
+        h ^= vkd3d_shader_hash_round(0, vkd3d_shader_hash_read64(code));
+        h = vkd3d_shader_hash_rotl(h, 27) * VKD3D_SHADER_HASH_PRIME1 + VKD3D_SHADER_HASH_PRIME4;
+        code += 8;
+    }
+
+    if (end - code >= 4)
+    {
+        h ^= vkd3d_shader_hash_read32(code) * VKD3D_SHADER_HASH_PRIME1;
+        h = vkd3d_shader_hash_rotl(h, 23) * VKD3D_SHADER_HASH_PRIME2 + VKD3D_SHADER_HASH_PRIME3;
+        code += 4;
+    }
+
+    while (code < end)
+    {
+        h ^= *code++ * VKD3D_SHADER_HASH_PRIME5;
+        h = vkd3d_shader_hash_rotl(h, 11) * VKD3D_SHADER_HASH_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= VKD3D_SHADER_HASH_PRIME2;
+    h ^= h >> 29;
+    h *= VKD3D_SHADER_HASH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Persistent SPIR-V cache. Every entry is a single file named after the shader hash
+ * and a hash of everything else which affects code generation. */
+#define VKD3D_SHADER_CACHE_MAGIC 0x43534b56 /* VKSC */
+#define VKD3D_SHADER_CACHE_FORMAT_VERSION 1
+
+struct vkd3d_shader_cache_header
+{
+    uint32_t magic;
+    uint32_t format_version;
+    uint64_t build;
+    vkd3d_shader_hash_t hash;
+    uint64_t key;
+    uint64_t spirv_hash;
+    uint32_t spirv_size;
+    uint32_t reserved;
+};
+
+static const char *vkd3d_shader_cache_path(void)
+{
+    static bool initialized;
+    static const char *path;
+
+    if (!initialized)
+    {
+        path = getenv("VKD3D_SHADER_CACHE_PATH");
+        /* Overrides are looked up by the compilers, a cache hit would bypass them. */
+        if (path && getenv("VKD3D_SHADER_OVERRIDE"))
+        {
+            WARN("Ignoring VKD3D_SHADER_CACHE_PATH since VKD3D_SHADER_OVERRIDE is set.\n");
+            path = NULL;
+        }
+        else if (path)
+            INFO("Using persistent SPIR-V cache in %s.\n", path);
+        initialized = true;
+    }
+
+    return path;
+}
+
+bool vkd3d_shader_cache_enabled(void)
+{
+    return !!vkd3d_shader_cache_path();
+}
+
+static inline uint64_t vkd3d_shader_cache_key_u64(uint64_t key, uint64_t value)
+{
+    return vkd3d_shader_hash_merge(key, value);
+}
+
+static inline uint64_t vkd3d_shader_cache_key_binding(uint64_t key,
+        const struct vkd3d_shader_descriptor_binding *binding)
+{
+    /* Optional bindings must not alias with a binding at set 0, binding 0. */
+    if (!binding)
+        return vkd3d_shader_cache_key_u64(key, ~(uint64_t)0);
+    return vkd3d_shader_cache_key_u64(key, ((uint64_t)binding->set << 32) | binding->binding);
+}
+
+static inline uint64_t vkd3d_shader_cache_key_string(uint64_t key, const char *str)
+{
+    struct vkd3d_shader_code code;
+
+    code.code = str ? str : "";
+    code.size = str ? strlen(str) : 0;
+    return vkd3d_shader_cache_key_u64(key, vkd3d_shader_hash(&code));
+}
+
+static uint64_t vkd3d_shader_cache_key_interface(uint64_t key,
+        const struct vkd3d_shader_interface_info *info)
+{
+    const struct vkd3d_shader_transform_feedback_element *xfb_element;
+    const struct vkd3d_shader_push_constant_buffer *push_constant;
+    const struct vkd3d_shader_resource_binding *binding;
+    unsigned int i;
+
+    if (!info)
+        return vkd3d_shader_cache_key_u64(key, 0);
+
+    key = vkd3d_shader_cache_key_u64(key, info->flags);
+    key = vkd3d_shader_cache_key_u64(key, info->min_ssbo_alignment);
+    key = vkd3d_shader_cache_key_u64(key, info->descriptor_tables.offset);
+    key = vkd3d_shader_cache_key_u64(key, info->descriptor_tables.count);
+    key = vkd3d_shader_cache_key_u64(key, info->stage);
+
+    key = vkd3d_shader_cache_key_u64(key, info->binding_count);
+    for (i = 0; i < info->binding_count; i++)
+    {
+        binding = &info->bindings[i];
+        key = vkd3d_shader_cache_key_u64(key, binding->type);
+        key = vkd3d_shader_cache_key_u64(key, binding->register_space);
+        key = vkd3d_shader_cache_key_u64(key, binding->register_index);
+        key = vkd3d_shader_cache_key_u64(key, binding->register_count);
+        key = vkd3d_shader_cache_key_u64(key, binding->descriptor_table);
+        key = vkd3d_shader_cache_key_u64(key, binding->descriptor_offset);
+        key = vkd3d_shader_cache_key_u64(key, binding->shader_visibility);
+        key = vkd3d_shader_cache_key_u64(key, binding->flags);
+        key = vkd3d_shader_cache_key_binding(key, &binding->binding);
+    }
+
+    key = vkd3d_shader_cache_key_u64(key, info->push_constant_buffer_count);
+    for (i = 0; i < info->push_constant_buffer_count; i++)
+    {
+        push_constant = &info->push_constant_buffers[i];
+        key = vkd3d_shader_cache_key_u64(key, push_constant->register_space);
+        key = vkd3d_shader_cache_key_u64(key, push_constant->register_index);
+        key = vkd3d_shader_cache_key_u64(key, push_constant->shader_visibility);
+        key = vkd3d_shader_cache_key_u64(key, push_constant->offset);
+        key = vkd3d_shader_cache_key_u64(key, push_constant->size);
+    }
+
+    key = vkd3d_shader_cache_key_binding(key, info->push_constant_ubo_binding);
+    key = vkd3d_shader_cache_key_binding(key, info->offset_buffer_binding);
+    key = vkd3d_shader_cache_key_binding(key, info->descriptor_qa_global_binding);
+    key = vkd3d_shader_cache_key_binding(key, info->descriptor_qa_heap_binding);
+
+    if (info->xfb_info)
+    {
+        key = vkd3d_shader_cache_key_u64(key, info->xfb_info->element_count);
+        for (i = 0; i < info->xfb_info->element_count; i++)
+        {
+            xfb_element = &info->xfb_info->elements[i];
+            key = vkd3d_shader_cache_key_u64(key, xfb_element->stream_index);
+            key = vkd3d_shader_cache_key_string(key, xfb_element->semantic_name);
+            key = vkd3d_shader_cache_key_u64(key, xfb_element->semantic_index);
+            key = vkd3d_shader_cache_key_u64(key, xfb_element->component_index);
+            key = vkd3d_shader_cache_key_u64(key, xfb_element->component_count);
+            key = vkd3d_shader_cache_key_u64(key, xfb_element->output_slot);
+        }
+
+        key = vkd3d_shader_cache_key_u64(key, info->xfb_info->buffer_stride_count);
+        for (i = 0; i < info->xfb_info->buffer_stride_count; i++)
+            key = vkd3d_shader_cache_key_u64(key, info->xfb_info->buffer_strides[i]);
+    }
+    else
+        key = vkd3d_shader_cache_key_u64(key, ~(uint64_t)0);
+
+    return key;
+}
+
+static uint64_t vkd3d_shader_cache_key_compile_args(uint64_t key,
+        const struct vkd3d_shader_compile_arguments *args)
+{
+    const struct vkd3d_shader_parameter *parameter;
+    unsigned int i;
+
+    if (!args)
+        return vkd3d_shader_cache_key_u64(key, 0);
+
+    key = vkd3d_shader_cache_key_u64(key, args->target);
+    key = vkd3d_shader_cache_key_u64(key, args->dual_source_blending);
+    key = vkd3d_shader_cache_key_u64(key, args->config_flags);
+
+    key = vkd3d_shader_cache_key_u64(key, args->target_extension_count);
+    for (i = 0; i < args->target_extension_count; i++)
+        key = vkd3d_shader_cache_key_u64(key, args->target_extensions[i]);
+
+    key = vkd3d_shader_cache_key_u64(key, args->parameter_count);
+    for (i = 0; i < args->parameter_count; i++)
+    {
+        parameter = &args->parameters[i];
+        key = vkd3d_shader_cache_key_u64(key, parameter->name);
+        key = vkd3d_shader_cache_key_u64(key, parameter->type);
+        key = vkd3d_shader_cache_key_u64(key, parameter->data_type);
+        /* Both union members are a single uint32_t. */
+        key = vkd3d_shader_cache_key_u64(key, parameter->immediate_constant.u32);
+    }
+
+    key = vkd3d_shader_cache_key_u64(key, args->output_swizzle_count);
+    for (i = 0; i < args->output_swizzle_count; i++)
+        key = vkd3d_shader_cache_key_u64(key, args->output_swizzles[i]);
+
+    return key;
+}
+
+void vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *dxbc,
+        unsigned int compiler_options, const struct vkd3d_shader_interface_info *shader_interface_info,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    uint64_t k;
+
+    key->hash = vkd3d_shader_hash(dxbc);
+
+    k = vkd3d_shader_cache_key_u64(dxbc->size, VKD3D_SHADER_CACHE_FORMAT_VERSION);
+    k = vkd3d_shader_cache_key_u64(k, compiler_options);
+    k = vkd3d_shader_cache_key_interface(k, shader_interface_info);
+    k = vkd3d_shader_cache_key_compile_args(k, compile_args);
+    key->key = k;
+}
+
+static void vkd3d_shader_cache_get_filename(const struct vkd3d_shader_cache_key *key, char *filename, size_t size)
+{
+    snprintf(filename, size, "%s/%016"PRIx64"-%016"PRIx64".spvcache", vkd3d_shader_cache_path(), key->hash, key->key);
+}
+
+bool vkd3d_shader_cache_load(const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_header header;
+    struct vkd3d_shader_code payload;
+    char filename[1024];
+    void *code = NULL;
+    bool invalid;
+    FILE *f;
+
+    vkd3d_shader_cache_get_filename(key, filename, sizeof(filename));
+
+    if (!(f = fopen(filename, "rb")))
+        return false;
+
+    /* Entries are renamed into place once complete, so anything
+     * that fails validation is stale or corrupt and can be removed. */
+    invalid = true;
+
+    if (fread(&header, sizeof(header), 1, f) != 1)
+        goto fail;
+
+    /* Entries from a different build are stale, the compiler might have changed. */
+    if (header.magic != VKD3D_SHADER_CACHE_MAGIC ||
+            header.format_version != VKD3D_SHADER_CACHE_FORMAT_VERSION ||
+            header.build != vkd3d_build ||
+            header.hash != key->hash || header.key != key->key ||
+            !header.spirv_size || (header.spirv_size & 3))
+        goto fail;
+
+    if (!(code = vkd3d_malloc(header.spirv_size)))
+    {
+        invalid = false;
+        goto fail;
+    }
+
+    if (fread(code, 1, header.spirv_size, f) != header.spirv_size)
+        goto fail;
+
+    payload.code = code;
+    payload.size = header.spirv_size;
+    if (vkd3d_shader_hash(&payload) != header.spirv_hash)
+    {
+        WARN("Corrupt shader cache entry %s.\n", filename);
+        goto fail;
+    }
+
+    fclose(f);
+
+    TRACE("Loaded shader %016"PRIx64" from %s.\n", header.hash, filename);
+    spirv->code = code;
+    spirv->size = header.spirv_size;
+    spirv->meta.hash = header.hash;
+    spirv->meta.replaced = false;
+    return true;
+
+fail:
+    vkd3d_free(code);
+    fclose(f);
+
+    if (invalid)
+    {
+        TRACE("Removing invalid shader cache entry %s.\n", filename);
+        remove(filename);
+    }
+    return false;
+}
+
+void vkd3d_shader_cache_store(const struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *spirv)
+{
+    struct vkd3d_shader_cache_header header;
+    char tmp_filename[1100];
+    char filename[1024];
+    bool written;
+    FILE *f;
+
+    if (spirv->size > UINT32_MAX)
+        return;
+
+    vkd3d_shader_cache_get_filename(key, filename, sizeof(filename));
+    /* Thread IDs are unique system-wide, so concurrent writers never share a temp file. */
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.%u.tmp", filename, vkd3d_get_current_thread_id());
+
+    memset(&header, 0, sizeof(header));
+    header.magic = VKD3D_SHADER_CACHE_MAGIC;
+    header.format_version = VKD3D_SHADER_CACHE_FORMAT_VERSION;
+    header.build = vkd3d_build;
+    header.hash = key->hash;
+    header.key = key->key;
+    header.spirv_hash = vkd3d_shader_hash(spirv);
+    header.spirv_size = spirv->size;
+
+    /* Write the entry to a temporary file first and rename it into place,
+     * so that readers never observe a partially written entry. */
+    if (!(f = fopen(tmp_filename, "wb")))
+        return;
+
+    written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(spirv->code, 1, spirv->size, f) == spirv->size;
+    if (!written)
+        ERR("Failed to write shader cache entry %s.\n", tmp_filename);
+    if (fclose(f))
+    {
+        ERR("Failed to close stream %s.\n", tmp_filename);
+        written = false;
+    }
+
+    /* If another thread or process got there first, the entry is identical. */
+    if (!written || rename(tmp_filename, filename))
+        remove(tmp_filename);
+}
@@ -802,8 +802,23 @@ void vkd3d_shader_dump_spirv_shader(vkd3d_shader_hash_t hash, const struct vkd3d
 void vkd3d_shader_dump_spirv_shader_export(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader,
         const char *export);
 void vkd3d_shader_dump_shader(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader, const char *ext);
-bool vkd3d_shader_replace(vkd3d_shader_hash_t hash, const void **data, size_t *size);
-bool vkd3d_shader_replace_export(vkd3d_shader_hash_t hash, const void **data, size_t *size, const char *export);
+bool vkd3d_shader_replace(const struct vkd3d_shader_code *shader, vkd3d_shader_hash_t hash,
+        const void **data, size_t *size);
+bool vkd3d_shader_replace_export(const struct vkd3d_shader_code *shader, vkd3d_shader_hash_t hash,
+        const void **data, size_t *size, const char *export);
+
+struct vkd3d_shader_cache_key
+{
+    vkd3d_shader_hash_t hash;
+    uint64_t key;
+};
+
+bool vkd3d_shader_cache_enabled(void);
+void vkd3d_shader_cache_key_init(struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *dxbc,
+        unsigned int compiler_options, const struct vkd3d_shader_interface_info *shader_interface_info,
+        const struct vkd3d_shader_compile_arguments *compile_args);
+bool vkd3d_shader_cache_load(const struct vkd3d_shader_cache_key *key, struct vkd3d_shader_code *spirv);
+void vkd3d_shader_cache_store(const struct vkd3d_shader_cache_key *key, const struct vkd3d_shader_code *spirv);
 
 static inline enum vkd3d_component_type vkd3d_component_type_from_data_type(
         enum vkd3d_data_type data_type)
@@ -27,7 +27,9 @@
 #endif
 
 static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, uint64_t value);
-static void d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
+static HRESULT d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
+        const struct d3d12_command_queue_submission *sub);
+static void d3d12_command_queue_add_control_submission(struct d3d12_command_queue *queue,
         const struct d3d12_command_queue_submission *sub);
 static void d3d12_fence_inc_ref(struct d3d12_fence *fence);
 static void d3d12_fence_dec_ref(struct d3d12_fence *fence);
@@ -258,6 +260,28 @@ static HRESULT vkd3d_create_timeline_semaphore(struct d3d12_device *device, uint
     return hresult_from_vk_result(vr);
 }
 
+static void vkd3d_fence_worker_wake_locked(struct vkd3d_fence_worker *worker)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &worker->device->vk_procs;
+    VkSemaphoreSignalInfoKHR signal_info;
+    VkResult vr;
+
+    /* Only signal once per wait, the worker picks up everything that
+     * was enqueued in the meantime after it wakes up. */
+    if (!worker->waiting_on_gpu)
+        return;
+
+    worker->waiting_on_gpu = false;
+
+    signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO_KHR;
+    signal_info.pNext = NULL;
+    signal_info.semaphore = worker->wake_semaphore;
+    signal_info.value = ++worker->wake_value;
+
+    if ((vr = VK_CALL(vkSignalSemaphoreKHR(worker->device->vk_device, &signal_info))))
+        ERR("Failed to signal fence worker wake semaphore, vr %d.\n", vr);
+}
+
 static HRESULT vkd3d_enqueue_timeline_semaphore(struct vkd3d_fence_worker *worker,
         struct d3d12_fence *fence, uint64_t value, struct vkd3d_queue *queue)
 {
@@ -288,16 +312,33 @@ static HRESULT vkd3d_enqueue_timeline_semaphore(struct vkd3d_fence_worker *worke
     ++worker->enqueued_fence_count;
 
     pthread_cond_signal(&worker->cond);
+    vkd3d_fence_worker_wake_locked(worker);
     pthread_mutex_unlock(&worker->mutex);
     return S_OK;
 }
 
+static void vkd3d_fence_worker_retire_fence(struct vkd3d_fence_worker *worker, const struct vkd3d_waiting_fence *fence)
+{
+    struct d3d12_device *device = worker->device;
+    HRESULT hr;
+
+    /* This is a good time to kick the debug threads into action. */
+    if (device->debug_ring.active)
+        pthread_cond_signal(&device->debug_ring.ring_cond);
+    vkd3d_descriptor_debug_kick_qa_check(device->descriptor_qa_global_info);
+
+    TRACE("Signaling fence %p value %#"PRIx64".\n", fence->fence, fence->value);
+    if (FAILED(hr = d3d12_fence_signal(fence->fence, fence->value)))
+        ERR("Failed to signal D3D12 fence, hr %#x.\n", hr);
+
+    d3d12_fence_dec_ref(fence->fence);
+}
+
 static void vkd3d_wait_for_gpu_timeline_semaphore(struct vkd3d_fence_worker *worker, const struct vkd3d_waiting_fence *fence)
 {
     struct d3d12_device *device = worker->device;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkSemaphoreWaitInfoKHR wait_info;
-    HRESULT hr;
     int vr;
 
     wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
@@ -313,33 +354,149 @@ static void vkd3d_wait_for_gpu_timeline_semaphore(struct vkd3d_fence_worker *wor
         return;
     }
 
-    /* This is a good time to kick the debug threads into action. */
-    if (device->debug_ring.active)
-        pthread_cond_signal(&device->debug_ring.ring_cond);
-    vkd3d_descriptor_debug_kick_qa_check(device->descriptor_qa_global_info);
+    vkd3d_fence_worker_retire_fence(worker, fence);
+}
 
-    TRACE("Signaling fence %p value %#"PRIx64".\n", fence->fence, fence->value);
-    if (FAILED(hr = d3d12_fence_signal(fence->fence, fence->value)))
-        ERR("Failed to signal D3D12 fence, hr %#x.\n", hr);
+struct vkd3d_fence_worker_wait_list
+{
+    struct vkd3d_waiting_fence *fences;
+    size_t fences_size;
+    uint32_t fence_count;
 
-    d3d12_fence_dec_ref(fence->fence);
+    VkSemaphore *vk_semaphores;
+    size_t vk_semaphores_size;
+    uint64_t *vk_values;
+    size_t vk_values_size;
+};
+
+static bool vkd3d_fence_worker_wait_list_append_locked(struct vkd3d_fence_worker_wait_list *list,
+        struct vkd3d_fence_worker *worker)
+{
+    size_t count = list->fence_count + worker->enqueued_fence_count;
+
+    /* Reserve the wait arrays up front, with one extra slot for the wake semaphore,
+     * so that building the wait info later cannot fail. */
+    if (!vkd3d_array_reserve((void **)&list->fences, &list->fences_size,
+                count, sizeof(*list->fences)) ||
+            !vkd3d_array_reserve((void **)&list->vk_semaphores, &list->vk_semaphores_size,
+                count + 1, sizeof(*list->vk_semaphores)) ||
+            !vkd3d_array_reserve((void **)&list->vk_values, &list->vk_values_size,
+                count + 1, sizeof(*list->vk_values)))
+    {
+        ERR("Failed to grow fence wait list.\n");
+        return false;
+    }
+
+    memcpy(list->fences + list->fence_count, worker->enqueued_fences,
+            worker->enqueued_fence_count * sizeof(*worker->enqueued_fences));
+    list->fence_count = count;
+    worker->enqueued_fence_count = 0;
+    return true;
+}
+
+static uint32_t vkd3d_fence_worker_wait_list_find_semaphore(const struct vkd3d_fence_worker_wait_list *list,
+        uint32_t semaphore_count, VkSemaphore vk_semaphore)
+{
+    uint32_t i;
+
+    /* Batches rarely involve more than a handful of distinct fences */
+    for (i = 0; i < semaphore_count; i++)
+    {
+        if (list->vk_semaphores[i] == vk_semaphore)
+            break;
+    }
+
+    return i;
+}
+
+static void vkd3d_fence_worker_wait_any(struct vkd3d_fence_worker *worker,
+        struct vkd3d_fence_worker_wait_list *list, uint64_t wake_value)
+{
+    struct d3d12_device *device = worker->device;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    uint32_t i, j, count, semaphore_count;
+    VkSemaphoreWaitInfoKHR wait_info;
+    VkSemaphore vk_semaphore;
+    VkResult vr;
+
+    wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    wait_info.pNext = NULL;
+    wait_info.flags = VK_SEMAPHORE_WAIT_ANY_BIT_KHR;
+    wait_info.semaphoreCount = 0;
+    wait_info.pSemaphores = list->vk_semaphores;
+    wait_info.pValues = list->vk_values;
+
+    for (i = 0; i < list->fence_count; i++)
+    {
+        /* Queues share the worker, so values of one fence are not necessarily enqueued
+         * in increasing order. Wait for the smallest one to not sleep past a signal. */
+        vk_semaphore = list->fences[i].fence->timeline_semaphore;
+        j = vkd3d_fence_worker_wait_list_find_semaphore(list, wait_info.semaphoreCount, vk_semaphore);
+
+        if (j < wait_info.semaphoreCount)
+        {
+            list->vk_values[j] = min(list->vk_values[j], list->fences[i].value);
+            continue;
+        }
+
+        list->vk_semaphores[wait_info.semaphoreCount] = vk_semaphore;
+        list->vk_values[wait_info.semaphoreCount] = list->fences[i].value;
+        wait_info.semaphoreCount++;
+    }
+
+    semaphore_count = wait_info.semaphoreCount;
+    list->vk_semaphores[wait_info.semaphoreCount] = worker->wake_semaphore;
+    list->vk_values[wait_info.semaphoreCount] = wake_value;
+    wait_info.semaphoreCount++;
+
+    if ((vr = VK_CALL(vkWaitSemaphoresKHR(device->vk_device, &wait_info, ~(uint64_t)0))))
+    {
+        /* Give up on the fences like the single fence path does, retrying would just spin. */
+        ERR("Failed to wait for Vulkan timeline semaphores, vr %d.\n", vr);
+        for (i = 0; i < list->fence_count; i++)
+            d3d12_fence_dec_ref(list->fences[i].fence);
+        list->fence_count = 0;
+        return;
+    }
+
+    /* Query every semaphore once, reusing the value array for the completed values. */
+    for (j = 0; j < semaphore_count; j++)
+    {
+        if ((vr = VK_CALL(vkGetSemaphoreCounterValueKHR(device->vk_device, list->vk_semaphores[j], &list->vk_values[j]))))
+        {
+            ERR("Failed to query timeline semaphore value, vr %d.\n", vr);
+            list->vk_values[j] = 0;
+        }
+    }
+
+    /* Retire everything that has completed in submission order and keep the rest. */
+    for (i = 0, count = 0; i < list->fence_count; i++)
+    {
+        j = vkd3d_fence_worker_wait_list_find_semaphore(list, semaphore_count,
+                list->fences[i].fence->timeline_semaphore);
+
+        if (list->vk_values[j] >= list->fences[i].value)
+            vkd3d_fence_worker_retire_fence(worker, &list->fences[i]);
+        else
+            list->fences[count++] = list->fences[i];
+    }
+
+    list->fence_count = count;
 }
 
 static void *vkd3d_fence_worker_main(void *arg)
 {
-    struct vkd3d_waiting_fence *cur_fences, *old_fences;
+    struct vkd3d_waiting_fence *enqueued_fences;
+    struct vkd3d_fence_worker_wait_list list;
     struct vkd3d_fence_worker *worker = arg;
-    size_t cur_fences_size, old_fences_size;
-    uint32_t cur_fence_count;
-    uint32_t i;
-    bool do_exit;
+    uint32_t enqueued_fence_count, i;
+    struct vkd3d_waiting_fence fence;
+    uint64_t wake_value;
     int rc;
 
     vkd3d_set_thread_name("vkd3d_fence");
 
-    cur_fence_count = 0;
-    cur_fences_size = 0;
-    cur_fences = NULL;
+    memset(&list, 0, sizeof(list));
 
     for (;;)
     {
@@ -349,7 +506,9 @@ static void *vkd3d_fence_worker_main(void *arg)
             break;
         }
 
-        if (!worker->enqueued_fence_count && !worker->should_exit)
+        worker->waiting_on_gpu = false;
+
+        if (!list.fence_count && !worker->enqueued_fence_count && !worker->should_exit)
         {
             if ((rc = pthread_cond_wait(&worker->cond, &worker->mutex)))
             {
@@ -359,34 +518,60 @@ static void *vkd3d_fence_worker_main(void *arg)
             }
         }
 
-        old_fences_size = cur_fences_size;
-        old_fences = cur_fences;
+        if (worker->enqueued_fence_count && !vkd3d_fence_worker_wait_list_append_locked(&list, worker) &&
+                !list.fence_count && !worker->should_exit)
+        {
+            /* Retrying the append right away would spin. Nothing older is pending,
+             * so wait for the oldest enqueued fence on its own, which needs no memory. */
+            fence = worker->enqueued_fences[0];
+            worker->enqueued_fence_count -= 1;
+            memmove(worker->enqueued_fences, worker->enqueued_fences + 1,
+                    worker->enqueued_fence_count * sizeof(*worker->enqueued_fences));
+            pthread_mutex_unlock(&worker->mutex);
 
-        cur_fence_count = worker->enqueued_fence_count;
-        cur_fences_size = worker->enqueued_fences_size;
-        cur_fences = worker->enqueued_fences;
-        do_exit = worker->should_exit;
+            vkd3d_wait_for_gpu_timeline_semaphore(worker, &fence);
+            continue;
+        }
 
-        worker->enqueued_fence_count = 0;
-        worker->enqueued_fences_size = old_fences_size;
-        worker->enqueued_fences = old_fences;
+        if (worker->should_exit)
+        {
+            /* Take ownership of whatever could not be appended while still holding the lock. */
+            enqueued_fences = worker->enqueued_fences;
+            enqueued_fence_count = worker->enqueued_fence_count;
+            worker->enqueued_fences = NULL;
+            worker->enqueued_fences_size = 0;
+            worker->enqueued_fence_count = 0;
+            pthread_mutex_unlock(&worker->mutex);
 
-        pthread_mutex_unlock(&worker->mutex);
+            for (i = 0; i < list.fence_count; i++)
+                vkd3d_wait_for_gpu_timeline_semaphore(worker, &list.fences[i]);
+            for (i = 0; i < enqueued_fence_count; i++)
+                vkd3d_wait_for_gpu_timeline_semaphore(worker, &enqueued_fences[i]);
+            vkd3d_free(enqueued_fences);
+            break;
+        }
 
-        for (i = 0; i < cur_fence_count; i++)
-            vkd3d_wait_for_gpu_timeline_semaphore(worker, &cur_fences[i]);
+        /* Producers signal the wake semaphore while we are blocked on the GPU,
+         * so new fences do not have to wait behind the ones already pending. */
+        worker->waiting_on_gpu = !!list.fence_count;
+        wake_value = worker->wake_value + 1;
 
-        if (do_exit)
-            break;
+        pthread_mutex_unlock(&worker->mutex);
+
+        if (list.fence_count)
+            vkd3d_fence_worker_wait_any(worker, &list, wake_value);
     }
 
-    vkd3d_free(cur_fences);
+    vkd3d_free(list.fences);
+    vkd3d_free(list.vk_semaphores);
+    vkd3d_free(list.vk_values);
     return NULL;
 }
 
 HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
         struct d3d12_device *device)
 {
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     HRESULT hr;
     int rc;
 
@@ -399,9 +584,16 @@ HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
     worker->enqueued_fences = NULL;
     worker->enqueued_fences_size = 0;
 
+    worker->wake_value = 0;
+    worker->waiting_on_gpu = false;
+
+    if (FAILED(hr = vkd3d_create_timeline_semaphore(device, 0, &worker->wake_semaphore)))
+        return hr;
+
     if ((rc = pthread_mutex_init(&worker->mutex, NULL)))
     {
         ERR("Failed to initialize mutex, error %d.\n", rc);
+        VK_CALL(vkDestroySemaphore(device->vk_device, worker->wake_semaphore, NULL));
         return hresult_from_errno(rc);
     }
 
@@ -409,6 +601,7 @@ HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
     {
         ERR("Failed to initialize condition variable, error %d.\n", rc);
         pthread_mutex_destroy(&worker->mutex);
+        VK_CALL(vkDestroySemaphore(device->vk_device, worker->wake_semaphore, NULL));
         return hresult_from_errno(rc);
     }
 
@@ -417,6 +610,7 @@ HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
     {
         pthread_mutex_destroy(&worker->mutex);
         pthread_cond_destroy(&worker->cond);
+        VK_CALL(vkDestroySemaphore(device->vk_device, worker->wake_semaphore, NULL));
     }
 
     return hr;
@@ -425,6 +619,7 @@ HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
 HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
         struct d3d12_device *device)
 {
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     HRESULT hr;
     int rc;
 
@@ -438,6 +633,7 @@ HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
 
     worker->should_exit = true;
     pthread_cond_signal(&worker->cond);
+    vkd3d_fence_worker_wake_locked(worker);
 
     pthread_mutex_unlock(&worker->mutex);
 
@@ -446,6 +642,7 @@ HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
 
     pthread_mutex_destroy(&worker->mutex);
     pthread_cond_destroy(&worker->cond);
+    VK_CALL(vkDestroySemaphore(device->vk_device, worker->wake_semaphore, NULL));
 
     vkd3d_free(worker->enqueued_fences);
     return S_OK;
@@ -1229,6 +1426,7 @@ static VkDescriptorPool d3d12_command_allocator_allocate_descriptor_pool(
         {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1024},
         {VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1024},
         {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 64},
         /* must be last in the array */
         {VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT, 65536}
     };
@@ -1496,9 +1694,16 @@ static ULONG STDMETHODCALLTYPE d3d12_command_allocator_Release(ID3D12CommandAllo
         for (i = 0; i < allocator->scratch_buffer_count; i++)
             d3d12_device_return_scratch_buffer(device, &allocator->scratch_buffers[i]);
 
+        for (i = 0; i < allocator->cached_scratch_buffer_count; i++)
+            d3d12_device_return_scratch_buffer(device, &allocator->cached_scratch_buffers[i]);
+
+        for (i = 0; i < allocator->root_parameter_buffer_count; i++)
+            vkd3d_free_memory(device, &device->memory_allocator, &allocator->root_parameter_buffers[i].allocation);
+
         for (i = 0; i < allocator->query_pool_count; i++)
             d3d12_device_return_query_pool(device, &allocator->query_pools[i]);
 
+        vkd3d_free(allocator->root_parameter_buffers);
         vkd3d_free(allocator->scratch_buffers);
         vkd3d_free(allocator->query_pools);
         vkd3d_free(allocator);
@@ -1608,12 +1813,30 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_Reset(ID3D12CommandAllo
         return hresult_from_vk_result(vr);
     }
 
-    /* Return scratch buffers to the device */
+    /* Keep a few default-sized scratch buffers around for the next use of
+     * this allocator, and return everything else to the device */
     for (i = 0; i < allocator->scratch_buffer_count; i++)
-        d3d12_device_return_scratch_buffer(device, &allocator->scratch_buffers[i]);
+    {
+        if (allocator->scratch_buffers[i].allocation.resource.size == VKD3D_SCRATCH_BUFFER_SIZE &&
+                allocator->cached_scratch_buffer_count < ARRAY_SIZE(allocator->cached_scratch_buffers))
+        {
+            allocator->cached_scratch_buffers[allocator->cached_scratch_buffer_count++] = allocator->scratch_buffers[i];
+        }
+        else
+            d3d12_device_return_scratch_buffer(device, &allocator->scratch_buffers[i]);
+    }
 
     allocator->scratch_buffer_count = 0;
 
+    /* Descriptor sets were freed along with the descriptor pools */
+    for (i = 0; i < allocator->root_parameter_buffer_count; i++)
+    {
+        allocator->root_parameter_buffers[i].vk_descriptor_set = VK_NULL_HANDLE;
+        allocator->root_parameter_buffers[i].offset = 0;
+    }
+
+    allocator->root_parameter_buffer_index = 0;
+
     /* Return query pools to the device */
     for (i = 0; i < allocator->query_pool_count; i++)
         d3d12_device_return_query_pool(device, &allocator->query_pools[i]);
@@ -1751,6 +1974,12 @@ static HRESULT d3d12_command_allocator_init(struct d3d12_command_allocator *allo
     allocator->scratch_buffers = NULL;
     allocator->scratch_buffers_size = 0;
     allocator->scratch_buffer_count = 0;
+    allocator->cached_scratch_buffer_count = 0;
+
+    allocator->root_parameter_buffers = NULL;
+    allocator->root_parameter_buffers_size = 0;
+    allocator->root_parameter_buffer_count = 0;
+    allocator->root_parameter_buffer_index = 0;
 
     allocator->query_pools = NULL;
     allocator->query_pools_size = 0;
@@ -1802,29 +2031,48 @@ struct vkd3d_scratch_allocation
 static bool d3d12_command_allocator_allocate_scratch_memory(struct d3d12_command_allocator *allocator,
         VkDeviceSize size, VkDeviceSize alignment, struct vkd3d_scratch_allocation *allocation)
 {
-    VkDeviceSize aligned_offset, aligned_size;
-    struct vkd3d_scratch_buffer *scratch;
+    VkDeviceSize aligned_offset, aligned_size, best_offset, best_space, space;
+    struct vkd3d_scratch_buffer *scratch, *best_scratch;
     unsigned int i;
 
     aligned_size = align(size, alignment);
+    best_scratch = NULL;
+    best_offset = 0;
+    best_space = 0;
 
-    /* Probe last block first since the others are likely full */
-    for (i = allocator->scratch_buffer_count; i; i--)
+    /* Use the fullest block that still fits the request. This packs small
+     * requests densely and leaves room in other blocks for larger ones. */
+    for (i = 0; i < allocator->scratch_buffer_count; i++)
     {
-        scratch = &allocator->scratch_buffers[i - 1];
+        scratch = &allocator->scratch_buffers[i];
         aligned_offset = align(scratch->offset, alignment);
 
-        if (aligned_offset + aligned_size <= scratch->allocation.resource.size)
+        if (aligned_offset + aligned_size > scratch->allocation.resource.size)
+            continue;
+
+        space = scratch->allocation.resource.size - (aligned_offset + aligned_size);
+
+        if (!best_scratch || space < best_space)
         {
-            scratch->offset = aligned_offset + aligned_size;
+            best_scratch = scratch;
+            best_offset = aligned_offset;
+            best_space = space;
 
-            allocation->buffer = scratch->allocation.resource.vk_buffer;
-            allocation->offset = scratch->allocation.offset + aligned_offset;
-            allocation->va = scratch->allocation.resource.va + aligned_offset;
-            return true;
+            if (!space)
+                break;
         }
     }
 
+    if (best_scratch)
+    {
+        best_scratch->offset = best_offset + aligned_size;
+
+        allocation->buffer = best_scratch->allocation.resource.vk_buffer;
+        allocation->offset = best_scratch->allocation.offset + best_offset;
+        allocation->va = best_scratch->allocation.resource.va + best_offset;
+        return true;
+    }
+
     if (!vkd3d_array_reserve((void**)&allocator->scratch_buffers, &allocator->scratch_buffers_size,
             allocator->scratch_buffer_count + 1, sizeof(*allocator->scratch_buffers)))
     {
@@ -1833,7 +2081,12 @@ static bool d3d12_command_allocator_allocate_scratch_memory(struct d3d12_command
     }
 
     scratch = &allocator->scratch_buffers[allocator->scratch_buffer_count];
-    if (FAILED(d3d12_device_get_scratch_buffer(allocator->device, aligned_size, scratch)))
+
+    if (aligned_size <= VKD3D_SCRATCH_BUFFER_SIZE && allocator->cached_scratch_buffer_count)
+    {
+        *scratch = allocator->cached_scratch_buffers[--allocator->cached_scratch_buffer_count];
+    }
+    else if (FAILED(d3d12_device_get_scratch_buffer(allocator->device, aligned_size, scratch)))
     {
         ERR("Failed to create scratch buffer.\n");
         return false;
@@ -1848,6 +2101,108 @@ static bool d3d12_command_allocator_allocate_scratch_memory(struct d3d12_command
     return true;
 }
 
+struct vkd3d_root_parameter_allocation
+{
+    VkDescriptorSet vk_descriptor_set;
+    uint32_t dynamic_offset;
+    void *host_ptr;
+};
+
+static bool d3d12_command_allocator_create_root_parameter_buffer(struct d3d12_command_allocator *allocator)
+{
+    struct vkd3d_allocate_heap_memory_info alloc_info;
+    struct vkd3d_root_parameter_buffer *buffer;
+    struct d3d12_device *device;
+
+    if (!vkd3d_array_reserve((void**)&allocator->root_parameter_buffers, &allocator->root_parameter_buffers_size,
+            allocator->root_parameter_buffer_count + 1, sizeof(*allocator->root_parameter_buffers)))
+        return false;
+
+    device = allocator->device;
+    buffer = &allocator->root_parameter_buffers[allocator->root_parameter_buffer_count];
+
+    memset(&alloc_info, 0, sizeof(alloc_info));
+    alloc_info.heap_desc.Properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+    alloc_info.heap_desc.SizeInBytes = VKD3D_ROOT_PARAMETER_BUFFER_SIZE;
+    alloc_info.heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    alloc_info.heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+    if (FAILED(vkd3d_allocate_heap_memory(device, &device->memory_allocator, &alloc_info, &buffer->allocation)))
+        return false;
+
+    buffer->vk_descriptor_set = VK_NULL_HANDLE;
+    buffer->offset = 0;
+
+    allocator->root_parameter_buffer_count += 1;
+    return true;
+}
+
+static bool d3d12_command_allocator_allocate_root_parameters(struct d3d12_command_allocator *allocator,
+        VkDescriptorSetLayout vk_set_layout, VkDeviceSize size, struct vkd3d_root_parameter_allocation *allocation)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &allocator->device->vk_procs;
+    struct vkd3d_root_parameter_buffer *buffer;
+    VkDescriptorBufferInfo buffer_info;
+    VkWriteDescriptorSet vk_write;
+    VkDeviceSize alignment, offset;
+
+    alignment = allocator->device->device_info.properties2.properties.limits.minUniformBufferOffsetAlignment;
+
+    /* The descriptor always covers the largest possible root parameter
+     * block, so that range must fit at any offset we hand out. */
+    while (true)
+    {
+        if (allocator->root_parameter_buffer_index == allocator->root_parameter_buffer_count &&
+                !d3d12_command_allocator_create_root_parameter_buffer(allocator))
+        {
+            ERR("Failed to allocate root parameter buffer.\n");
+            return false;
+        }
+
+        buffer = &allocator->root_parameter_buffers[allocator->root_parameter_buffer_index];
+        offset = align(buffer->offset, alignment);
+
+        if (offset + VKD3D_ROOT_PARAMETER_BUFFER_RANGE <= buffer->allocation.resource.size)
+            break;
+
+        allocator->root_parameter_buffer_index += 1;
+    }
+
+    if (!buffer->vk_descriptor_set)
+    {
+        /* Sets are allocated with the layout of whichever root signature
+         * gets there first. All of these layouts are identical, so the set
+         * is compatible with every root signature using this path. */
+        if (!(buffer->vk_descriptor_set = d3d12_command_allocator_allocate_descriptor_set(
+                allocator, vk_set_layout, VKD3D_DESCRIPTOR_POOL_TYPE_STATIC)))
+            return false;
+
+        buffer_info.buffer = buffer->allocation.resource.vk_buffer;
+        buffer_info.offset = buffer->allocation.offset;
+        buffer_info.range = VKD3D_ROOT_PARAMETER_BUFFER_RANGE;
+
+        vk_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        vk_write.pNext = NULL;
+        vk_write.dstSet = buffer->vk_descriptor_set;
+        vk_write.dstBinding = 0;
+        vk_write.dstArrayElement = 0;
+        vk_write.descriptorCount = 1;
+        vk_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        vk_write.pImageInfo = NULL;
+        vk_write.pBufferInfo = &buffer_info;
+        vk_write.pTexelBufferView = NULL;
+
+        VK_CALL(vkUpdateDescriptorSets(allocator->device->vk_device, 1, &vk_write, 0, NULL));
+    }
+
+    buffer->offset = offset + size;
+
+    allocation->vk_descriptor_set = buffer->vk_descriptor_set;
+    allocation->dynamic_offset = offset;
+    allocation->host_ptr = void_ptr_offset(buffer->allocation.cpu_address, offset);
+    return true;
+}
+
 static struct vkd3d_query_pool *d3d12_command_allocator_get_active_query_pool_from_type_index(
         struct d3d12_command_allocator *allocator, uint32_t type_index)
 {
@@ -3078,10 +3433,39 @@ cleanup:
     return result;
 }
 
+static void d3d12_command_list_flush_deferred_barrier(struct d3d12_command_list *list)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct vkd3d_deferred_barrier *barrier = &list->deferred_barrier;
+    VkMemoryBarrier vk_barrier;
+
+    if (!barrier->src_stage_mask || !barrier->dst_stage_mask)
+        return;
+
+    vk_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    vk_barrier.pNext = NULL;
+    vk_barrier.srcAccessMask = barrier->src_access_mask;
+    vk_barrier.dstAccessMask = barrier->dst_access_mask;
+
+    VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer,
+            barrier->src_stage_mask, barrier->dst_stage_mask, 0,
+            1, &vk_barrier, 0, NULL, 0, NULL));
+
+    barrier->src_stage_mask = 0;
+    barrier->dst_stage_mask = 0;
+    barrier->src_access_mask = 0;
+    barrier->dst_access_mask = 0;
+    barrier->issued_count += 1;
+}
+
 static void d3d12_command_list_end_current_render_pass(struct d3d12_command_list *list, bool suspend)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
 
+    /* Barriers are only ever deferred outside of render passes, so everything
+     * recorded from here on is ordered after them, same as with an immediate barrier. */
+    d3d12_command_list_flush_deferred_barrier(list);
+
     d3d12_command_list_handle_active_queries(list, true);
 
     if (list->xfb_enabled)
@@ -3399,36 +3783,48 @@ static void vk_access_and_stage_flags_from_d3d12_resource_state(const struct d3d
         FIXME("Unhandled resource state %#x.\n", unhandled_state);
 }
 
-static void d3d12_command_list_add_transition(struct d3d12_command_list *list, struct vkd3d_initial_transition *transition)
+struct vkd3d_initial_transition_entry
 {
-    bool skip;
-    size_t i;
+    struct hash_map_entry entry;
+    const void *object;
+};
 
-    /* Search in reverse as we're more likely to use same resource again. */
-    for (i = list->init_transitions_count; i; i--)
-    {
-        if (list->init_transitions[i - 1].type != transition->type)
-            continue;
+static uint32_t vkd3d_initial_transition_entry_hash(const void *key)
+{
+    return hash_uint64((uintptr_t)*(const void * const *)key);
+}
 
-        switch (transition->type)
-        {
-            case VKD3D_INITIAL_TRANSITION_TYPE_RESOURCE:
-                skip = list->init_transitions[i - 1].resource.resource == transition->resource.resource;
-                break;
+static bool vkd3d_initial_transition_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_initial_transition_entry *e = (const struct vkd3d_initial_transition_entry *)entry;
+    return *(const void * const *)key == e->object;
+}
 
-            case VKD3D_INITIAL_TRANSITION_TYPE_QUERY_HEAP:
-                skip = list->init_transitions[i - 1].query_heap == transition->query_heap;
-                break;
+static void d3d12_command_list_add_transition(struct d3d12_command_list *list, struct vkd3d_initial_transition *transition)
+{
+    struct vkd3d_initial_transition_entry entry;
 
-            default:
-                ERR("Unhandled transition type %u.\n", transition->type);
-                continue;
-        }
+    /* Resources and query heaps are distinct objects, so the
+     * object pointer alone identifies a transition. The array
+     * keeps submission order, the map only deduplicates. */
+    switch (transition->type)
+    {
+        case VKD3D_INITIAL_TRANSITION_TYPE_RESOURCE:
+            entry.object = transition->resource.resource;
+            break;
 
-        if (skip)
+        case VKD3D_INITIAL_TRANSITION_TYPE_QUERY_HEAP:
+            entry.object = transition->query_heap;
+            break;
+
+        default:
+            ERR("Unhandled transition type %u.\n", transition->type);
             return;
     }
 
+    if (hash_map_find(&list->init_transition_map, &entry.object))
+        return;
+
     if (!vkd3d_array_reserve((void**)&list->init_transitions, &list->init_transitions_size,
             list->init_transitions_count + 1, sizeof(*list->init_transitions)))
     {
@@ -3451,6 +3847,12 @@ static void d3d12_command_list_add_transition(struct d3d12_command_list *list, s
             ERR("Unhandled transition type %u.\n", transition->type);
     }
 
+    if (!hash_map_insert(&list->init_transition_map, &entry.object, &entry.entry))
+    {
+        ERR("Failed to insert transition into hash map.\n");
+        return;
+    }
+
     list->init_transitions[list->init_transitions_count++] = *transition;
 }
 
@@ -3539,6 +3941,7 @@ static ULONG STDMETHODCALLTYPE d3d12_command_list_Release(d3d12_command_list_ifa
             d3d12_command_allocator_free_command_buffer(list->allocator, list);
 
         vkd3d_free(list->init_transitions);
+        hash_map_clear(&list->init_transition_map);
         vkd3d_free(list->query_ranges);
         vkd3d_free(list->active_queries);
         vkd3d_free(list->pending_queries);
@@ -3644,6 +4047,22 @@ static HRESULT d3d12_command_list_build_init_commands(struct d3d12_command_list
     return S_OK;
 }
 
+static void d3d12_command_list_report_barrier_stats(struct d3d12_command_list *list)
+{
+    const struct vkd3d_deferred_barrier *barrier = &list->deferred_barrier;
+    VKD3D_REGION_DECL(barriers_issued);
+    VKD3D_REGION_DECL(barriers_elided);
+
+    TRACE("Command list %p issued %u pipeline barriers, elided %u barriers.\n",
+            list, barrier->issued_count, barrier->elided_count);
+
+    /* Counts show up as iterations of empty regions in the profiling output */
+    VKD3D_REGION_BEGIN(barriers_issued);
+    VKD3D_REGION_END_ITERATIONS(barriers_issued, barrier->issued_count);
+    VKD3D_REGION_BEGIN(barriers_elided);
+    VKD3D_REGION_END_ITERATIONS(barriers_elided, barrier->elided_count);
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_command_list_Close(d3d12_command_list_iface *iface)
 {
     struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
@@ -3660,6 +4079,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_list_Close(d3d12_command_list_ifa
     }
 
     d3d12_command_list_end_current_render_pass(list, false);
+    d3d12_command_list_report_barrier_stats(list);
 
     if (list->predicate_enabled)
         VK_CALL(vkCmdEndConditionalRenderingEXT(list->vk_command_buffer));
@@ -3920,11 +4340,14 @@ static void d3d12_command_list_reset_internal_state(struct d3d12_command_list *l
     list->has_replaced_shaders = false;
 
     list->init_transitions_count = 0;
+    hash_map_reset(&list->init_transition_map);
     list->query_ranges_count = 0;
     list->active_queries_count = 0;
     list->pending_queries_count = 0;
 
     list->render_pass_suspended = false;
+
+    memset(&list->deferred_barrier, 0, sizeof(list->deferred_barrier));
 }
 
 static void d3d12_command_list_reset_state(struct d3d12_command_list *list,
@@ -4042,7 +4465,8 @@ static bool d3d12_command_list_create_framebuffer(struct d3d12_command_list *lis
 
 static bool d3d12_command_list_update_current_framebuffer(struct d3d12_command_list *list)
 {
-    VkImageView views[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
+    struct vkd3d_view *views[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+    VkImageView vk_views[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
     struct d3d12_graphics_pipeline_state *graphics;
     VkFramebuffer vk_framebuffer;
     unsigned int view_count;
@@ -4069,7 +4493,7 @@ static bool d3d12_command_list_update_current_framebuffer(struct d3d12_command_l
             return false;
         }
 
-        views[view_count++] = list->rtvs[i].view->vk_image_view;
+        views[view_count++] = list->rtvs[i].view;
     }
 
     if (d3d12_command_list_has_depth_stencil_view(list))
@@ -4080,15 +4504,27 @@ static bool d3d12_command_list_update_current_framebuffer(struct d3d12_command_l
             return false;
         }
 
-        views[view_count++] = list->dsv.view->vk_image_view;
+        views[view_count++] = list->dsv.view;
     }
 
-    if (list->vrs_image)
-        views[view_count++] = list->vrs_image->vrs_view;
-
     d3d12_command_list_get_fb_extent(list, &extent.width, &extent.height, &extent.depth);
 
-    if (!d3d12_command_list_create_framebuffer(list, list->pso_render_pass, view_count, views, extent, &vk_framebuffer))
+    if (list->vrs_image)
+    {
+        /* The shading rate image view is not a vkd3d_view, so the cache
+         * would not know when to evict it. Use a transient framebuffer. */
+        for (i = 0; i < view_count; i++)
+            vk_views[i] = views[i]->vk_image_view;
+        vk_views[view_count] = list->vrs_image->vrs_view;
+
+        if (!d3d12_command_list_create_framebuffer(list, list->pso_render_pass, view_count + 1, vk_views, extent, &vk_framebuffer))
+        {
+            ERR("Failed to create framebuffer.\n");
+            return false;
+        }
+    }
+    else if (FAILED(vkd3d_framebuffer_cache_find(&list->device->framebuffer_cache, list->device,
+            list->pso_render_pass, view_count, views, &extent, &vk_framebuffer)))
     {
         ERR("Failed to create framebuffer.\n");
         return false;
@@ -4221,7 +4657,10 @@ static bool d3d12_command_list_update_graphics_pipeline(struct d3d12_command_lis
         if (!(vk_pipeline = d3d12_pipeline_state_get_or_create_pipeline(list->state,
                 &list->dynamic_state, dsv_format,
                 &vk_render_pass, &new_active_flags, variant_flags)))
+        {
+            d3d12_command_list_mark_as_invalid(list, "Failed to create pipeline variant.\n");
             return false;
+        }
     }
 
     /* The render pass cache ensures that we use the same Vulkan render pass
@@ -4557,6 +4996,35 @@ static void d3d12_command_list_update_root_descriptors(struct d3d12_command_list
     }
 }
 
+static void d3d12_command_list_update_root_parameter_buffer(struct d3d12_command_list *list,
+        struct vkd3d_pipeline_bindings *bindings, VkPipelineBindPoint vk_bind_point,
+        VkPipelineLayout layout)
+{
+    const struct d3d12_root_signature *root_signature = bindings->root_signature;
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct vkd3d_root_parameter_allocation allocation;
+    union root_parameter_data root_parameter_data;
+
+    if (!d3d12_command_allocator_allocate_root_parameters(list->allocator,
+            root_signature->vk_root_descriptor_layout, root_signature->push_constant_range.size, &allocation))
+    {
+        d3d12_command_list_mark_as_invalid(list, "Failed to allocate root parameter buffer.\n");
+        return;
+    }
+
+    /* Every update gets a fresh copy of the whole block, since
+     * previous copies may still be in use by earlier draws. */
+    d3d12_command_list_fetch_root_descriptor_vas(list, bindings, &root_parameter_data);
+    d3d12_command_list_fetch_inline_uniform_block_data(list, bindings, &root_parameter_data);
+    bindings->root_descriptor_dirty_mask = 0;
+
+    memcpy(allocation.host_ptr, &root_parameter_data, root_signature->push_constant_range.size);
+
+    VK_CALL(vkCmdBindDescriptorSets(list->vk_command_buffer, vk_bind_point,
+            layout, root_signature->root_descriptor_set,
+            1, &allocation.vk_descriptor_set, 1, &allocation.dynamic_offset));
+}
+
 static void d3d12_command_list_update_hoisted_descriptors(struct d3d12_command_list *list,
         struct vkd3d_pipeline_bindings *bindings)
 {
@@ -4637,7 +5105,14 @@ static void d3d12_command_list_update_descriptors(struct d3d12_command_list *lis
     if (bindings->dirty_flags & VKD3D_PIPELINE_DIRTY_HOISTED_DESCRIPTORS)
         d3d12_command_list_update_hoisted_descriptors(list, bindings);
 
-    if (rs->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK)
+    if (rs->flags & VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER)
+    {
+        /* All root parameters are streamed into the root parameter buffer */
+        if (bindings->root_descriptor_dirty_mask || bindings->root_constant_dirty_mask
+                || (bindings->dirty_flags & VKD3D_PIPELINE_DIRTY_DESCRIPTOR_TABLE_OFFSETS))
+            d3d12_command_list_update_root_parameter_buffer(list, bindings, vk_bind_point, layout);
+    }
+    else if (rs->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK)
     {
         /* Root constants and descriptor table offsets are part of the root descriptor set */
         if (bindings->root_descriptor_dirty_mask || bindings->root_constant_dirty_mask
@@ -4861,6 +5336,9 @@ static bool d3d12_command_list_begin_render_pass(struct d3d12_command_list *list
     VkRenderPassBeginInfo begin_desc;
     VkRenderPass vk_render_pass;
 
+    /* No-op while a render pass is active since barriers are never deferred inside one */
+    d3d12_command_list_flush_deferred_barrier(list);
+
     if (!d3d12_command_list_update_graphics_pipeline(list))
         return false;
     if (!d3d12_command_list_update_current_framebuffer(list))
@@ -6223,6 +6701,14 @@ static void STDMETHODCALLTYPE d3d12_command_list_SetPipelineState(d3d12_command_
         else
             list->active_bind_point = VK_PIPELINE_BIND_POINT_MAX_ENUM;
     }
+
+    /* Start compiling the fallback variant the next draw is most likely going to need. */
+    if (state)
+    {
+        d3d12_pipeline_state_prefetch_pipeline(state, &list->dynamic_state,
+                list->dsv.format ? list->dsv.format->vk_format : VK_FORMAT_UNDEFINED,
+                d3d12_command_list_variant_flags(list));
+    }
 }
 
 static void vk_image_memory_barrier_for_after_aliasing_barrier(struct d3d12_device *device,
@@ -6257,20 +6743,32 @@ static bool d3d12_resource_may_alias_other_resources(struct d3d12_resource *reso
     return true;
 }
 
+static bool d3d12_resource_state_is_read_only(D3D12_RESOURCE_STATES state)
+{
+    const D3D12_RESOURCE_STATES read_only_states = D3D12_RESOURCE_STATE_GENERIC_READ |
+            D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE |
+            D3D12_RESOURCE_STATE_SHADING_RATE_SOURCE;
+
+    /* COMMON may be used for anything, including implicit promotion to a write state */
+    return state && !(state & ~read_only_states);
+}
+
 static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_list_iface *iface,
         UINT barrier_count, const D3D12_RESOURCE_BARRIER *barriers)
 {
     struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct vkd3d_deferred_barrier *deferred_barrier = &list->deferred_barrier;
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
-    bool have_split_barriers = false;
     VkPipelineStageFlags dst_stage_mask, src_stage_mask;
+    unsigned int i, merged_count, elided_count;
     VkImageMemoryBarrier vk_image_barrier;
+    bool have_split_barriers = false;
     VkMemoryBarrier vk_memory_barrier;
-    unsigned int i;
 
     TRACE("iface %p, barrier_count %u, barriers %p.\n", iface, barrier_count, barriers);
 
-    d3d12_command_list_end_current_render_pass(list, false);
+    merged_count = 0;
+    elided_count = 0;
 
     vk_memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
     vk_memory_barrier.pNext = NULL;
@@ -6318,15 +6816,26 @@ static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_l
                     continue;
                 }
 
+                TRACE("Transition barrier (resource %p, subresource %#x, before %#x, after %#x).\n",
+                        preserve_resource, transition->Subresource, transition->StateBefore, transition->StateAfter);
+
+                /* Transitions never change image layouts here, so there is
+                 * no hazard to guard against unless one side may write. */
+                if (transition->StateBefore == transition->StateAfter ||
+                        (d3d12_resource_state_is_read_only(transition->StateBefore) &&
+                        d3d12_resource_state_is_read_only(transition->StateAfter)))
+                {
+                    elided_count++;
+                    break;
+                }
+
+                merged_count++;
                 vk_access_and_stage_flags_from_d3d12_resource_state(list->device, preserve_resource,
                         transition->StateBefore, list->vk_queue_flags, &src_stage_mask,
                         &vk_memory_barrier.srcAccessMask);
                 vk_access_and_stage_flags_from_d3d12_resource_state(list->device, preserve_resource,
                         transition->StateAfter, list->vk_queue_flags, &dst_stage_mask,
                         &vk_memory_barrier.dstAccessMask);
-
-                TRACE("Transition barrier (resource %p, subresource %#x, before %#x, after %#x).\n",
-                        preserve_resource, transition->Subresource, transition->StateBefore, transition->StateAfter);
                 break;
             }
 
@@ -6349,6 +6858,7 @@ static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_l
 
                 assert(state_mask);
 
+                merged_count++;
                 vk_access_and_stage_flags_from_d3d12_resource_state(list->device, preserve_resource,
                         state_mask, list->vk_queue_flags, &src_stage_mask,
                         &vk_memory_barrier.srcAccessMask);
@@ -6404,9 +6914,13 @@ static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_l
 
                         vk_image_memory_barrier_for_after_aliasing_barrier(list->device, list->vk_queue_flags,
                                 after, &vk_image_barrier);
+
+                        /* Layout transitions cannot be deferred, this also flushes pending barriers */
+                        d3d12_command_list_end_current_render_pass(list, false);
                         VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer,
                                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                                 0, 1, &alias_memory_barrier, 0, NULL, 1, &vk_image_barrier));
+                        deferred_barrier->issued_count += 1;
                     }
                     else
                     {
@@ -6415,12 +6929,15 @@ static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_l
                         alias_dst_access = vk_access_flags_all_possible_for_buffer(list->device,
                                 list->vk_queue_flags, true);
 
+                        merged_count++;
                         src_stage_mask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
                         dst_stage_mask |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
                         vk_memory_barrier.srcAccessMask |= alias_src_access;
                         vk_memory_barrier.dstAccessMask |= alias_dst_access;
                     }
                 }
+                else
+                    elided_count++;
                 break;
             }
 
@@ -6452,11 +6969,26 @@ static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier(d3d12_command_l
 
     if (src_stage_mask && dst_stage_mask)
     {
-        VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer,
-                src_stage_mask, dst_stage_mask, 0,
-                1, &vk_memory_barrier, 0, NULL, 0, NULL));
+        /* Vulkan cannot express these barriers inside a render pass. If a barrier is already pending,
+         * nothing was recorded since, and the render pass has already been ended. Deferred clears
+         * must be ordered before this barrier, so flush them along with the pending barrier. */
+        if (!deferred_barrier->src_stage_mask || list->clear_state.attachment_mask)
+            d3d12_command_list_end_current_render_pass(list, false);
+
+        /* All barriers in this call except one are folded into the pending
+         * barrier, or all of them if there is a pending barrier already. */
+        if (!deferred_barrier->src_stage_mask)
+            merged_count--;
+
+        deferred_barrier->src_stage_mask |= src_stage_mask;
+        deferred_barrier->dst_stage_mask |= dst_stage_mask;
+        deferred_barrier->src_access_mask |= vk_memory_barrier.srcAccessMask;
+        deferred_barrier->dst_access_mask |= vk_memory_barrier.dstAccessMask;
+        elided_count += merged_count;
     }
 
+    deferred_barrier->elided_count += elided_count;
+
     /* Vulkan doesn't support split barriers. */
     if (have_split_barriers)
         WARN("Issuing split barrier(s) on D3D12_RESOURCE_BARRIER_FLAG_END_ONLY.\n");
@@ -7753,6 +8285,7 @@ static void STDMETHODCALLTYPE d3d12_command_list_EndQuery(d3d12_command_list_ifa
             VK_CALL(vkCmdResetQueryPool(list->vk_command_buffer, query_heap->vk_query_pool, index, 1));
         }
 
+        d3d12_command_list_flush_deferred_barrier(list);
         VK_CALL(vkCmdWriteTimestamp(list->vk_command_buffer,
                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_heap->vk_query_pool, index));
     }
@@ -8395,6 +8928,7 @@ static void STDMETHODCALLTYPE d3d12_command_list_WriteBufferImmediate(d3d12_comm
 
         if (list->device->vk_info.AMD_buffer_marker)
         {
+            d3d12_command_list_flush_deferred_barrier(list);
             VK_CALL(vkCmdWriteBufferMarkerAMD(list->vk_command_buffer, stage,
                     resource->vk_buffer, offset, parameters[i].Value));
         }
@@ -8842,6 +9376,9 @@ static HRESULT d3d12_command_list_init(struct d3d12_command_list *list, struct d
 
     list->type = type;
 
+    hash_map_init(&list->init_transition_map, vkd3d_initial_transition_entry_hash,
+            vkd3d_initial_transition_entry_compare, sizeof(struct vkd3d_initial_transition_entry));
+
     if (FAILED(hr = vkd3d_private_store_init(&list->private_store)))
         return hr;
 
@@ -8952,7 +9489,8 @@ static ULONG STDMETHODCALLTYPE d3d12_command_queue_Release(ID3D12CommandQueue *i
         vkd3d_private_store_destroy(&command_queue->private_store);
 
         d3d12_command_queue_submit_stop(command_queue);
-        vkd3d_fence_worker_stop(&command_queue->fence_worker, device);
+        if (command_queue->fence_worker == &command_queue->queue_fence_worker)
+            vkd3d_fence_worker_stop(&command_queue->queue_fence_worker, device);
         d3d12_device_unmap_vkd3d_queue(device, command_queue->vkd3d_queue);
         pthread_join(command_queue->submission_thread, NULL);
         pthread_mutex_destroy(&command_queue->queue_lock);
@@ -9058,6 +9596,7 @@ static void STDMETHODCALLTYPE d3d12_command_queue_UpdateTileMappings(ID3D12Comma
     D3D12_TILE_RANGE_FLAGS range_flag;
     UINT range_size, range_offset;
     size_t bind_infos_size = 0;
+    HRESULT hr;
 
     TRACE("iface %p, resource %p, region_count %u, region_coords %p, "
             "region_sizes %p, heap %p, range_count %u, range_flags %p, heap_range_offsets %p, "
@@ -9178,7 +9717,13 @@ static void STDMETHODCALLTYPE d3d12_command_queue_UpdateTileMappings(ID3D12Comma
     }
 
     vkd3d_free(bound_tiles);
-    d3d12_command_queue_add_submission(command_queue, &sub);
+
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_device_mark_as_removed(command_queue->device, hr,
+                "Failed to queue tile mapping update.\n");
+        vkd3d_free(sub.bind_sparse.bind_infos);
+    }
     return;
 
 fail:
@@ -9197,6 +9742,7 @@ static void STDMETHODCALLTYPE d3d12_command_queue_CopyTileMappings(ID3D12Command
     struct d3d12_command_queue_submission sub;
     struct vkd3d_sparse_memory_bind *bind;
     unsigned int i;
+    HRESULT hr;
 
     TRACE("iface %p, dst_resource %p, dst_region_start_coordinate %p, "
             "src_resource %p, src_region_start_coordinate %p, region_size %p, flags %#x.\n",
@@ -9225,7 +9771,12 @@ static void STDMETHODCALLTYPE d3d12_command_queue_CopyTileMappings(ID3D12Command
         bind->vk_offset = 0;
     }
 
-    d3d12_command_queue_add_submission(command_queue, &sub);
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_device_mark_as_removed(command_queue->device, hr,
+                "Failed to queue tile mapping copy.\n");
+        vkd3d_free(sub.bind_sparse.bind_infos);
+    }
 }
 
 static void STDMETHODCALLTYPE d3d12_command_queue_ExecuteCommandLists(ID3D12CommandQueue *iface,
@@ -9350,7 +9901,18 @@ static void STDMETHODCALLTYPE d3d12_command_queue_ExecuteCommandLists(ID3D12Comm
     sub.execute.cmd_count = num_command_buffers;
     sub.execute.outstanding_submissions_counters = outstanding;
     sub.execute.outstanding_submissions_counter_count = command_list_count;
-    d3d12_command_queue_add_submission(command_queue, &sub);
+
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+    {
+        d3d12_device_mark_as_removed(command_queue->device, hr,
+                "Failed to queue command lists for execution.\n");
+
+        for (i = 0; i < command_list_count; i++)
+            InterlockedDecrement(outstanding[i]);
+        vkd3d_free(sub.execute.transitions);
+        vkd3d_free(outstanding);
+        vkd3d_free(buffers);
+    }
 }
 
 static void STDMETHODCALLTYPE d3d12_command_queue_SetMarker(ID3D12CommandQueue *iface,
@@ -9378,6 +9940,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Signal(ID3D12CommandQueue *
     struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
     struct d3d12_command_queue_submission sub;
     struct d3d12_fence *fence;
+    HRESULT hr;
 
     TRACE("iface %p, fence %p, value %#"PRIx64".\n", iface, fence_iface, value);
 
@@ -9387,8 +9950,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Signal(ID3D12CommandQueue *
     sub.type = VKD3D_SUBMISSION_SIGNAL;
     sub.signal.fence = fence;
     sub.signal.value = value;
-    d3d12_command_queue_add_submission(command_queue, &sub);
-    return S_OK;
+
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+        d3d12_fence_dec_ref(fence);
+    return hr;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Wait(ID3D12CommandQueue *iface,
@@ -9397,6 +9962,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Wait(ID3D12CommandQueue *if
     struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
     struct d3d12_command_queue_submission sub;
     struct d3d12_fence *fence;
+    HRESULT hr;
 
     TRACE("iface %p, fence %p, value %#"PRIx64".\n", iface, fence_iface, value);
 
@@ -9406,8 +9972,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Wait(ID3D12CommandQueue *if
     sub.type = VKD3D_SUBMISSION_WAIT;
     sub.wait.fence = fence;
     sub.wait.value = value;
-    d3d12_command_queue_add_submission(command_queue, &sub);
-    return S_OK;
+
+    if (FAILED(hr = d3d12_command_queue_add_submission(command_queue, &sub)))
+        d3d12_fence_dec_ref(fence);
+    return hr;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetTimestampFrequency(ID3D12CommandQueue *iface,
@@ -9681,7 +10249,7 @@ static void d3d12_command_queue_signal(struct d3d12_command_queue *command_queue
         return;
     }
 
-    if (FAILED(hr = vkd3d_enqueue_timeline_semaphore(&command_queue->fence_worker, fence, physical_value, vkd3d_queue)))
+    if (FAILED(hr = vkd3d_enqueue_timeline_semaphore(command_queue->fence_worker, fence, physical_value, vkd3d_queue)))
     {
         /* In case of an unexpected failure, try to safely destroy Vulkan objects. */
         vkd3d_queue_wait_idle(vkd3d_queue, vk_procs);
@@ -9926,56 +10494,73 @@ static void d3d12_command_queue_transition_pool_build(struct d3d12_command_queue
     *timeline_value = pool->timeline_value;
 }
 
+/* Every merged submission which needs initial transitions takes one transition
+ * command buffer. Recording more than the pool holds before submitting them
+ * would wait for a transition command buffer which was never submitted. */
+#define VKD3D_MAX_EXECUTE_SEGMENTS (VKD3D_COMMAND_QUEUE_NUM_TRANSITION_BUFFERS + 1)
+
+struct d3d12_command_queue_execute_segment
+{
+    VkCommandBuffer transition_cmd;
+    uint64_t transition_timeline_value;
+    VkCommandBuffer *cmd;
+    UINT cmd_count;
+};
+
 static void d3d12_command_queue_execute(struct d3d12_command_queue *command_queue,
-        VkCommandBuffer *cmd, UINT count,
-        VkCommandBuffer transition_cmd, VkSemaphore transition_timeline, uint64_t transition_timeline_value,
-        bool debug_capture)
+        const struct d3d12_command_queue_execute_segment *segments, unsigned int segment_count,
+        VkSemaphore transition_timeline, bool debug_capture)
 {
     static const VkPipelineStageFlags wait_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
     const struct vkd3d_vk_device_procs *vk_procs = &command_queue->device->vk_procs;
+    VkTimelineSemaphoreSubmitInfoKHR timeline_submit_info[2 * VKD3D_MAX_EXECUTE_SEGMENTS];
     struct vkd3d_queue *vkd3d_queue = command_queue->vkd3d_queue;
-    VkTimelineSemaphoreSubmitInfoKHR timeline_submit_info[2];
-    VkSubmitInfo submit_desc[2];
-    uint32_t num_submits;
+    const struct d3d12_command_queue_execute_segment *segment;
+    VkSubmitInfo submit_desc[2 * VKD3D_MAX_EXECUTE_SEGMENTS];
+    uint32_t num_submits = 0;
     VkQueue vk_queue;
     unsigned int i;
     VkResult vr;
 
-    TRACE("queue %p, command_list_count %u, command_lists %p.\n",
-          command_queue, count, cmd);
+    TRACE("queue %p, segment_count %u, segments %p.\n",
+          command_queue, segment_count, segments);
 
     memset(timeline_submit_info, 0, sizeof(timeline_submit_info));
     memset(submit_desc, 0, sizeof(submit_desc));
 
-    if (transition_cmd)
+    for (i = 0; i < segment_count; i++)
     {
-        /* The transition cmd must happen in-order, since with the advanced aliasing model in D3D12,
-         * it is enough to separate aliases with an ExecuteCommandLists.
-         * A clear-like operation must still happen though in the application which would acquire the alias,
-         * but we must still be somewhat careful about when we emit initial state transitions.
-         * The clear requirement only exists for render targets. */
-        num_submits = 2;
+        segment = &segments[i];
 
-        submit_desc[0].signalSemaphoreCount = 1;
-        submit_desc[0].pSignalSemaphores = &transition_timeline;
-        submit_desc[0].commandBufferCount = 1;
-        submit_desc[0].pCommandBuffers = &transition_cmd;
+        if (segment->transition_cmd)
+        {
+            /* The transition cmd must happen in-order, since with the advanced aliasing model in D3D12,
+             * it is enough to separate aliases with an ExecuteCommandLists.
+             * A clear-like operation must still happen though in the application which would acquire the alias,
+             * but we must still be somewhat careful about when we emit initial state transitions.
+             * The clear requirement only exists for render targets. */
+            submit_desc[num_submits].signalSemaphoreCount = 1;
+            submit_desc[num_submits].pSignalSemaphores = &transition_timeline;
+            submit_desc[num_submits].commandBufferCount = 1;
+            submit_desc[num_submits].pCommandBuffers = &segment->transition_cmd;
 
-        timeline_submit_info[0].signalSemaphoreValueCount = 1;
-        /* Could use the serializing binary semaphore here,
-         * but we need to keep track of the timeline on CPU as well
-         * to know when we can reset the barrier command buffer. */
-        timeline_submit_info[0].pSignalSemaphoreValues = &transition_timeline_value;
+            timeline_submit_info[num_submits].signalSemaphoreValueCount = 1;
+            /* Could use the serializing binary semaphore here,
+             * but we need to keep track of the timeline on CPU as well
+             * to know when we can reset the barrier command buffer. */
+            timeline_submit_info[num_submits].pSignalSemaphoreValues = &segment->transition_timeline_value;
+            num_submits++;
 
-        submit_desc[1].waitSemaphoreCount = 1;
-        timeline_submit_info[1].waitSemaphoreValueCount = 1;
-        timeline_submit_info[1].pWaitSemaphoreValues = &transition_timeline_value;
-        submit_desc[1].pWaitSemaphores = &transition_timeline;
-        submit_desc[1].pWaitDstStageMask = &wait_stage_mask;
-    }
-    else
-    {
-        num_submits = 1;
+            submit_desc[num_submits].waitSemaphoreCount = 1;
+            timeline_submit_info[num_submits].waitSemaphoreValueCount = 1;
+            timeline_submit_info[num_submits].pWaitSemaphoreValues = &segment->transition_timeline_value;
+            submit_desc[num_submits].pWaitSemaphores = &transition_timeline;
+            submit_desc[num_submits].pWaitDstStageMask = &wait_stage_mask;
+        }
+
+        submit_desc[num_submits].commandBufferCount = segment->cmd_count;
+        submit_desc[num_submits].pCommandBuffers = segment->cmd;
+        num_submits++;
     }
 
     if (!(vk_queue = vkd3d_queue_acquire(vkd3d_queue)))
@@ -9984,6 +10569,7 @@ static void d3d12_command_queue_execute(struct d3d12_command_queue *command_queu
         return;
     }
 
+    /* The first VkSubmitInfo never waits on a transition. */
     submit_desc[0].waitSemaphoreCount = vkd3d_queue->wait_count;
     submit_desc[0].pWaitSemaphores = vkd3d_queue->wait_semaphores;
     submit_desc[0].pWaitDstStageMask = vkd3d_queue->wait_stages;
@@ -9991,9 +10577,6 @@ static void d3d12_command_queue_execute(struct d3d12_command_queue *command_queu
     timeline_submit_info[0].waitSemaphoreValueCount = vkd3d_queue->wait_count;
     timeline_submit_info[0].pWaitSemaphoreValues = vkd3d_queue->wait_values;
 
-    submit_desc[num_submits - 1].commandBufferCount = count;
-    submit_desc[num_submits - 1].pCommandBuffers = cmd;
-
     for (i = 0; i < num_submits; i++)
     {
         submit_desc[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -10029,6 +10612,115 @@ static void d3d12_command_queue_execute(struct d3d12_command_queue *command_queu
     vkd3d_queue_release(vkd3d_queue);
 }
 
+/* Adjacent EXECUTE submissions without any WAIT, SIGNAL or BIND_SPARSE in between
+ * can be folded into one vkQueueSubmit, which is significantly cheaper for the driver
+ * when applications call ExecuteCommandLists many times per frame. */
+#define VKD3D_MAX_MERGED_EXECUTE_SUBMISSIONS 64
+
+static size_t d3d12_command_queue_count_mergeable_executes(const struct d3d12_command_queue_submission *submissions,
+        size_t count)
+{
+    unsigned int transition_count;
+    size_t i;
+
+    /* Keep debug captures isolated to the submission they were requested for. */
+    if (submissions[0].execute.debug_capture)
+        return 1;
+
+    count = min(count, VKD3D_MAX_MERGED_EXECUTE_SUBMISSIONS);
+    transition_count = submissions[0].execute.transition_count ? 1 : 0;
+
+    for (i = 1; i < count; i++)
+    {
+        if (submissions[i].type != VKD3D_SUBMISSION_EXECUTE || submissions[i].execute.debug_capture)
+            break;
+
+        if (submissions[i].execute.transition_count &&
+                ++transition_count > VKD3D_COMMAND_QUEUE_NUM_TRANSITION_BUFFERS)
+            break;
+    }
+
+    return i;
+}
+
+static void d3d12_command_queue_execute_submissions(struct d3d12_command_queue *queue,
+        struct d3d12_command_queue_transition_pool *pool,
+        const struct d3d12_command_queue_submission *submissions, size_t count,
+        VkCommandBuffer **cmd_buffers, size_t *cmd_buffers_size)
+{
+    struct d3d12_command_queue_execute_segment segments[VKD3D_MAX_EXECUTE_SEGMENTS];
+    const struct d3d12_command_queue_submission_execute *execute;
+    struct d3d12_command_queue_execute_segment *segment = NULL;
+    uint64_t transition_timeline_value;
+    unsigned int segment_count = 0;
+    VkCommandBuffer transition_cmd;
+    size_t cmd_count = 0;
+    VkCommandBuffer *cmd;
+    size_t i, j;
+
+    if (count > 1)
+    {
+        for (i = 0; i < count; i++)
+            cmd_count += submissions[i].execute.cmd_count;
+
+        if (!vkd3d_array_reserve((void **)cmd_buffers, cmd_buffers_size, cmd_count, sizeof(**cmd_buffers)))
+        {
+            ERR("Failed to allocate merged command buffer array.\n");
+            for (i = 0; i < count; i++)
+                d3d12_command_queue_execute_submissions(queue, pool, &submissions[i], 1, cmd_buffers, cmd_buffers_size);
+            return;
+        }
+
+        cmd = *cmd_buffers;
+        for (i = 0, cmd_count = 0; i < count; i++)
+        {
+            execute = &submissions[i].execute;
+            memcpy(cmd + cmd_count, execute->cmd, execute->cmd_count * sizeof(*cmd));
+            cmd_count += execute->cmd_count;
+        }
+    }
+    else
+        cmd = submissions[0].execute.cmd;
+
+    /* Initial transitions of each merged submission must run after the command buffers
+     * of the previous ones, so every submission with transitions starts a new segment. */
+    for (i = 0, cmd_count = 0; i < count; i++)
+    {
+        execute = &submissions[i].execute;
+
+        transition_timeline_value = 0;
+        d3d12_command_queue_transition_pool_build(pool, queue->device,
+                execute->transitions, execute->transition_count,
+                &transition_cmd, &transition_timeline_value);
+
+        if (!segment || transition_cmd)
+        {
+            segment = &segments[segment_count++];
+            segment->transition_cmd = transition_cmd;
+            segment->transition_timeline_value = transition_timeline_value;
+            segment->cmd = cmd + cmd_count;
+            segment->cmd_count = 0;
+        }
+
+        segment->cmd_count += execute->cmd_count;
+        cmd_count += execute->cmd_count;
+    }
+
+    d3d12_command_queue_execute(queue, segments, segment_count, pool->timeline,
+            submissions[0].execute.debug_capture);
+
+    for (i = 0; i < count; i++)
+    {
+        execute = &submissions[i].execute;
+        vkd3d_free(execute->cmd);
+        vkd3d_free(execute->transitions);
+        /* TODO: The correct place to do this would be in a fence handler, but this is good enough for now. */
+        for (j = 0; j < execute->outstanding_submissions_counter_count; j++)
+            InterlockedDecrement(execute->outstanding_submissions_counters[j]);
+        vkd3d_free(execute->outstanding_submissions_counters);
+    }
+}
+
 static unsigned int vkd3d_compact_sparse_bind_ranges(const struct d3d12_resource *src_resource,
         struct vkd3d_sparse_memory_bind_range *bind_ranges, struct vkd3d_sparse_memory_bind *bind_infos,
         unsigned int count, enum vkd3d_sparse_memory_bind_mode mode, bool can_compact)
@@ -10334,23 +11026,119 @@ void d3d12_command_queue_submit_stop(struct d3d12_command_queue *queue)
 {
     struct d3d12_command_queue_submission sub;
     sub.type = VKD3D_SUBMISSION_STOP;
-    d3d12_command_queue_add_submission(queue, &sub);
+    d3d12_command_queue_add_control_submission(queue, &sub);
+}
+
+#define VKD3D_INITIAL_SUBMISSION_RING_SIZE 64
+
+static bool d3d12_command_queue_grow_submission_ring_locked(struct d3d12_command_queue *queue)
+{
+    struct d3d12_command_queue_submission *new_submissions;
+    size_t new_size, first_count;
+
+    new_size = queue->submissions_size ? 2 * queue->submissions_size : VKD3D_INITIAL_SUBMISSION_RING_SIZE;
+
+    if (!(new_submissions = vkd3d_malloc(new_size * sizeof(*new_submissions))))
+        return false;
+
+    /* Unwrap the ring so that the oldest submission ends up at index 0. */
+    first_count = min(queue->submissions_count, queue->submissions_size - queue->submissions_head);
+    memcpy(new_submissions, queue->submissions + queue->submissions_head,
+            first_count * sizeof(*new_submissions));
+    memcpy(new_submissions + first_count, queue->submissions,
+            (queue->submissions_count - first_count) * sizeof(*new_submissions));
+
+    vkd3d_free(queue->submissions);
+    queue->submissions = new_submissions;
+    queue->submissions_size = new_size;
+    queue->submissions_head = 0;
+    return true;
 }
 
-static void d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
-                                                      const struct d3d12_command_queue_submission *sub)
+static HRESULT d3d12_command_queue_add_submission_locked(struct d3d12_command_queue *queue,
+                                                         const struct d3d12_command_queue_submission *sub)
 {
-    vkd3d_array_reserve((void**)&queue->submissions, &queue->submissions_size,
-                        queue->submissions_count + 1, sizeof(*queue->submissions));
-    queue->submissions[queue->submissions_count++] = *sub;
+    size_t index;
+
+    if (queue->submissions_count == queue->submissions_size &&
+            !d3d12_command_queue_grow_submission_ring_locked(queue))
+    {
+        ERR("Failed to grow submission ring for submission of type %u.\n", sub->type);
+        return E_OUTOFMEMORY;
+    }
+
+    index = (queue->submissions_head + queue->submissions_count) & (queue->submissions_size - 1);
+    queue->submissions[index] = *sub;
+    queue->submissions_count++;
     pthread_cond_signal(&queue->queue_cond);
+    return S_OK;
+}
+
+/* Stop and drain submissions must never be dropped. If the ring cannot grow,
+ * wait for the worker to make room instead, it broadcasts once it does. */
+static void d3d12_command_queue_add_control_submission_locked(struct d3d12_command_queue *queue,
+        const struct d3d12_command_queue_submission *sub)
+{
+    while (FAILED(d3d12_command_queue_add_submission_locked(queue, sub)))
+        pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
+}
+
+/* Moves pending submissions into the worker-local batch, so that the worker
+ * only needs a single lock acquisition no matter how many submissions are queued up. */
+static size_t d3d12_command_queue_dequeue_submissions_locked(struct d3d12_command_queue *queue,
+        struct d3d12_command_queue_submission **batch, size_t *batch_size)
+{
+    size_t count = queue->submissions_count;
+    size_t first_count, i;
+
+    /* Control submissions may be waiting for room in a full ring */
+    if (count == queue->submissions_size)
+        pthread_cond_broadcast(&queue->queue_cond);
+
+    /* A drain hands the queue to the serialized caller once it is processed.
+     * It must end the batch, so that the worker blocks on the queue lock
+     * before touching anything that was queued after it. */
+    for (i = 0; i < count; i++)
+    {
+        if (queue->submissions[(queue->submissions_head + i) & (queue->submissions_size - 1)].type ==
+                VKD3D_SUBMISSION_DRAIN)
+        {
+            count = i + 1;
+            break;
+        }
+    }
+
+    if (!vkd3d_array_reserve((void **)batch, batch_size, count, sizeof(**batch)))
+    {
+        /* Degrade gracefully to one submission at a time. The batch array always has room for one. */
+        count = 1;
+    }
+
+    first_count = min(count, queue->submissions_size - queue->submissions_head);
+    memcpy(*batch, queue->submissions + queue->submissions_head, first_count * sizeof(**batch));
+    memcpy(*batch + first_count, queue->submissions, (count - first_count) * sizeof(**batch));
+
+    queue->submissions_head = (queue->submissions_head + count) & (queue->submissions_size - 1);
+    queue->submissions_count -= count;
+    return count;
 }
 
-static void d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
+static HRESULT d3d12_command_queue_add_submission(struct d3d12_command_queue *queue,
         const struct d3d12_command_queue_submission *sub)
 {
+    HRESULT hr;
+
     pthread_mutex_lock(&queue->queue_lock);
-    d3d12_command_queue_add_submission_locked(queue, sub);
+    hr = d3d12_command_queue_add_submission_locked(queue, sub);
+    pthread_mutex_unlock(&queue->queue_lock);
+    return hr;
+}
+
+static void d3d12_command_queue_add_control_submission(struct d3d12_command_queue *queue,
+        const struct d3d12_command_queue_submission *sub)
+{
+    pthread_mutex_lock(&queue->queue_lock);
+    d3d12_command_queue_add_control_submission_locked(queue, sub);
     pthread_mutex_unlock(&queue->queue_lock);
 }
 
@@ -10366,7 +11154,7 @@ static void d3d12_command_queue_acquire_serialized(struct d3d12_command_queue *q
     pthread_mutex_lock(&queue->queue_lock);
 
     current_drain = ++queue->drain_count;
-    d3d12_command_queue_add_submission_locked(queue, &sub);
+    d3d12_command_queue_add_control_submission_locked(queue, &sub);
 
     while (current_drain != queue->queue_drain_count)
         pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
@@ -10379,12 +11167,14 @@ static void d3d12_command_queue_release_serialized(struct d3d12_command_queue *q
 
 static void *d3d12_command_queue_submission_worker_main(void *userdata)
 {
+    struct d3d12_command_queue_submission *submissions = NULL;
     struct d3d12_command_queue_submission submission;
     struct d3d12_command_queue_transition_pool pool;
     struct d3d12_command_queue *queue = userdata;
-    uint64_t transition_timeline_value = 0;
-    VkCommandBuffer transition_cmd;
-    unsigned int i;
+    VkCommandBuffer *merged_cmd_buffers = NULL;
+    size_t batch_count, merge_count, j;
+    size_t merged_cmd_buffers_size = 0;
+    size_t submissions_size = 0;
     HRESULT hr;
 
     VKD3D_REGION_DECL(queue_wait);
@@ -10396,79 +11186,80 @@ static void *d3d12_command_queue_submission_worker_main(void *userdata)
     if (FAILED(hr = d3d12_command_queue_transition_pool_init(&pool, queue)))
         ERR("Failed to initialize transition pool.\n");
 
+    if (!vkd3d_array_reserve((void **)&submissions, &submissions_size,
+            VKD3D_INITIAL_SUBMISSION_RING_SIZE, sizeof(*submissions)))
+    {
+        ERR("Failed to allocate submission batch.\n");
+        goto cleanup;
+    }
+
     for (;;)
     {
         pthread_mutex_lock(&queue->queue_lock);
         while (queue->submissions_count == 0)
             pthread_cond_wait(&queue->queue_cond, &queue->queue_lock);
-
-        queue->submissions_count--;
-        submission = queue->submissions[0];
-        memmove(queue->submissions, queue->submissions + 1, queue->submissions_count * sizeof(submission));
+        batch_count = d3d12_command_queue_dequeue_submissions_locked(queue, &submissions, &submissions_size);
         pthread_mutex_unlock(&queue->queue_lock);
 
-        switch (submission.type)
+        for (j = 0; j < batch_count; j++)
         {
-        case VKD3D_SUBMISSION_STOP:
-            goto cleanup;
+            submission = submissions[j];
 
-        case VKD3D_SUBMISSION_WAIT:
-            VKD3D_REGION_BEGIN(queue_wait);
-            d3d12_command_queue_wait(queue, submission.wait.fence, submission.wait.value);
-            d3d12_fence_dec_ref(submission.wait.fence);
-            VKD3D_REGION_END(queue_wait);
-            break;
+            switch (submission.type)
+            {
+            case VKD3D_SUBMISSION_STOP:
+                goto cleanup;
 
-        case VKD3D_SUBMISSION_SIGNAL:
-            VKD3D_REGION_BEGIN(queue_signal);
-            d3d12_command_queue_signal(queue, submission.signal.fence, submission.signal.value);
-            d3d12_fence_dec_ref(submission.signal.fence);
-            VKD3D_REGION_END(queue_signal);
-            break;
+            case VKD3D_SUBMISSION_WAIT:
+                VKD3D_REGION_BEGIN(queue_wait);
+                d3d12_command_queue_wait(queue, submission.wait.fence, submission.wait.value);
+                d3d12_fence_dec_ref(submission.wait.fence);
+                VKD3D_REGION_END(queue_wait);
+                break;
 
-        case VKD3D_SUBMISSION_EXECUTE:
-            VKD3D_REGION_BEGIN(queue_execute);
-            d3d12_command_queue_transition_pool_build(&pool, queue->device,
-                    submission.execute.transitions,
-                    submission.execute.transition_count,
-                    &transition_cmd, &transition_timeline_value);
-            d3d12_command_queue_execute(queue, submission.execute.cmd,
-                    submission.execute.cmd_count,
-                    transition_cmd, pool.timeline, transition_timeline_value,
-                    submission.execute.debug_capture);
-            vkd3d_free(submission.execute.cmd);
-            vkd3d_free(submission.execute.transitions);
-            /* TODO: The correct place to do this would be in a fence handler, but this is good enough for now. */
-            for (i = 0; i < submission.execute.outstanding_submissions_counter_count; i++)
-                InterlockedDecrement(submission.execute.outstanding_submissions_counters[i]);
-            vkd3d_free(submission.execute.outstanding_submissions_counters);
-            VKD3D_REGION_END(queue_execute);
-            break;
+            case VKD3D_SUBMISSION_SIGNAL:
+                VKD3D_REGION_BEGIN(queue_signal);
+                d3d12_command_queue_signal(queue, submission.signal.fence, submission.signal.value);
+                d3d12_fence_dec_ref(submission.signal.fence);
+                VKD3D_REGION_END(queue_signal);
+                break;
 
-        case VKD3D_SUBMISSION_BIND_SPARSE:
-            d3d12_command_queue_bind_sparse(queue, submission.bind_sparse.mode,
-                    submission.bind_sparse.dst_resource, submission.bind_sparse.src_resource,
-                    submission.bind_sparse.bind_count, submission.bind_sparse.bind_infos);
-            vkd3d_free(submission.bind_sparse.bind_infos);
-            break;
+            case VKD3D_SUBMISSION_EXECUTE:
+                VKD3D_REGION_BEGIN(queue_execute);
+                merge_count = d3d12_command_queue_count_mergeable_executes(&submissions[j], batch_count - j);
+                d3d12_command_queue_execute_submissions(queue, &pool, &submissions[j], merge_count,
+                        &merged_cmd_buffers, &merged_cmd_buffers_size);
+                j += merge_count - 1;
+                VKD3D_REGION_END_ITERATIONS(queue_execute, merge_count);
+                break;
 
-        case VKD3D_SUBMISSION_DRAIN:
-        {
-            pthread_mutex_lock(&queue->queue_lock);
-            queue->queue_drain_count++;
-            pthread_cond_signal(&queue->queue_cond);
-            pthread_mutex_unlock(&queue->queue_lock);
-            break;
-        }
+            case VKD3D_SUBMISSION_BIND_SPARSE:
+                d3d12_command_queue_bind_sparse(queue, submission.bind_sparse.mode,
+                        submission.bind_sparse.dst_resource, submission.bind_sparse.src_resource,
+                        submission.bind_sparse.bind_count, submission.bind_sparse.bind_infos);
+                vkd3d_free(submission.bind_sparse.bind_infos);
+                break;
 
-        default:
-            ERR("Unrecognized submission type %u.\n", submission.type);
-            break;
+            case VKD3D_SUBMISSION_DRAIN:
+            {
+                pthread_mutex_lock(&queue->queue_lock);
+                queue->queue_drain_count++;
+                pthread_cond_signal(&queue->queue_cond);
+                pthread_mutex_unlock(&queue->queue_lock);
+                break;
+            }
+
+            default:
+                ERR("Unrecognized submission type %u.\n", submission.type);
+                break;
+            }
         }
     }
 
 cleanup:
     d3d12_command_queue_transition_pool_deinit(&pool, queue->device);
+    vkd3d_free(merged_cmd_buffers);
+    vkd3d_free(submissions);
     return NULL;
 }
 
@@ -10488,11 +11279,20 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
     queue->vkd3d_queue = d3d12_device_allocate_vkd3d_queue(device,
             d3d12_device_get_vkd3d_queue_family(device, desc->Type));
     queue->submissions = NULL;
+    queue->submissions_head = 0;
     queue->submissions_count = 0;
     queue->submissions_size = 0;
     queue->drain_count = 0;
     queue->queue_drain_count = 0;
 
+    /* Allocate the ring up front, so that control submissions
+     * waiting for room always have a worker to wait for. */
+    if (!d3d12_command_queue_grow_submission_ring_locked(queue))
+    {
+        hr = E_OUTOFMEMORY;
+        goto fail;
+    }
+
     if ((rc = pthread_mutex_init(&queue->queue_lock, NULL)) < 0)
     {
         hr = hresult_from_errno(rc);
@@ -10522,8 +11322,14 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
 
     d3d12_device_add_ref(queue->device = device);
 
-    if (FAILED(hr = vkd3d_fence_worker_start(&queue->fence_worker, device)))
-        goto fail_fence_worker_start;
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER)
+        queue->fence_worker = &device->shared_fence_worker;
+    else
+    {
+        queue->fence_worker = &queue->queue_fence_worker;
+        if (FAILED(hr = vkd3d_fence_worker_start(&queue->queue_fence_worker, device)))
+            goto fail_fence_worker_start;
+    }
 
     if ((rc = pthread_create(&queue->submission_thread, NULL, d3d12_command_queue_submission_worker_main, queue)) < 0)
     {
@@ -10535,7 +11341,8 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
     return S_OK;
 
 fail_pthread_create:
-    vkd3d_fence_worker_stop(&queue->fence_worker, device);
+    if (queue->fence_worker == &queue->queue_fence_worker)
+        vkd3d_fence_worker_stop(&queue->queue_fence_worker, device);
 fail_fence_worker_start:;
 #ifdef VKD3D_BUILD_STANDALONE_D3D12
 fail_swapchain_factory:
@@ -10546,6 +11353,7 @@ fail_private_store:
 fail_pthread_cond:
     pthread_mutex_destroy(&queue->queue_lock);
 fail:
+    vkd3d_free(queue->submissions);
     d3d12_device_unmap_vkd3d_queue(device, queue->vkd3d_queue);
     return hr;
 }
@@ -10616,7 +11424,9 @@ VKD3D_EXPORT void vkd3d_enqueue_initial_transition(ID3D12CommandQueue *queue, ID
     sub.execute.transitions[0].type = VKD3D_INITIAL_TRANSITION_TYPE_RESOURCE;
     sub.execute.transitions[0].resource.resource = d3d12_resource;
     sub.execute.transitions[0].resource.perform_initial_transition = true;
-    d3d12_command_queue_add_submission(d3d12_queue, &sub);
+
+    if (FAILED(d3d12_command_queue_add_submission(d3d12_queue, &sub)))
+        vkd3d_free(sub.execute.transitions);
 }
 
 /* ID3D12CommandSignature */
@@ -452,6 +452,8 @@ static const struct vkd3d_debug_option vkd3d_config_options[] =
     {"single_queue", VKD3D_CONFIG_FLAG_SINGLE_QUEUE},
     {"force_tgsm_barriers", VKD3D_CONFIG_FLAG_FORCE_TGSM_BARRIERS},
     {"descriptor_qa_checks", VKD3D_CONFIG_FLAG_DESCRIPTOR_QA_CHECKS},
+    {"shared_fence_worker", VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER},
+    {"async_pipeline_compile", VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE},
 };
 
 static void vkd3d_config_flags_init_once(void)
@@ -2172,42 +2174,118 @@ static void d3d12_device_destroy_scratch_buffer(struct d3d12_device *device, con
     vkd3d_free_memory(device, &device->memory_allocator, &scratch->allocation);
 }
 
+static unsigned int vkd3d_scratch_pool_get_class_index(VkDeviceSize size)
+{
+    /* Sizes beyond the largest class are not pooled at all */
+    if (size <= VKD3D_SCRATCH_BUFFER_SIZE)
+        return 0;
+    if (size > (VKD3D_SCRATCH_BUFFER_SIZE << (VKD3D_SCRATCH_POOL_CLASS_COUNT - 1)))
+        return VKD3D_SCRATCH_POOL_CLASS_COUNT;
+    return vkd3d_log2i((unsigned int)((size - 1) / VKD3D_SCRATCH_BUFFER_SIZE)) + 1;
+}
+
+static void vkd3d_scratch_pool_decay(struct vkd3d_scratch_pool *pool)
+{
+    struct vkd3d_scratch_pool_class *pool_class;
+    unsigned int i;
+
+    if (++pool->return_count < VKD3D_SCRATCH_POOL_DECAY_INTERVAL)
+        return;
+
+    pool->return_count = 0;
+
+    for (i = 0; i < VKD3D_SCRATCH_POOL_CLASS_COUNT; i++)
+    {
+        pool_class = &pool->classes[i];
+        pool_class->high_water = max(pool_class->window_peak,
+                pool_class->high_water - pool_class->high_water / 4);
+        pool_class->window_peak = pool_class->in_use_count;
+    }
+}
+
 HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, VkDeviceSize min_size, struct vkd3d_scratch_buffer *scratch)
 {
-    if (min_size > VKD3D_SCRATCH_BUFFER_SIZE)
+    struct vkd3d_scratch_pool_class *pool_class;
+    unsigned int class_index;
+    HRESULT hr;
+
+    class_index = vkd3d_scratch_pool_get_class_index(min_size);
+
+    if (class_index >= VKD3D_SCRATCH_POOL_CLASS_COUNT)
         return d3d12_device_create_scratch_buffer(device, min_size, scratch);
 
+    pool_class = &device->scratch_pool.classes[class_index];
+
     pthread_mutex_lock(&device->mutex);
 
-    if (device->scratch_buffer_count)
+    pool_class->in_use_count += 1;
+    pool_class->window_peak = max(pool_class->window_peak, pool_class->in_use_count);
+
+    if (pool_class->buffer_count)
     {
-        *scratch = device->scratch_buffers[--device->scratch_buffer_count];
+        *scratch = pool_class->buffers[--pool_class->buffer_count];
         scratch->offset = 0;
         pthread_mutex_unlock(&device->mutex);
         return S_OK;
     }
-    else
+
+    pthread_mutex_unlock(&device->mutex);
+
+    if (FAILED(hr = d3d12_device_create_scratch_buffer(device,
+            VKD3D_SCRATCH_BUFFER_SIZE << class_index, scratch)))
     {
+        pthread_mutex_lock(&device->mutex);
+        pool_class->in_use_count -= 1;
         pthread_mutex_unlock(&device->mutex);
-        return d3d12_device_create_scratch_buffer(device, VKD3D_SCRATCH_BUFFER_SIZE, scratch);
     }
+
+    return hr;
 }
 
 void d3d12_device_return_scratch_buffer(struct d3d12_device *device, const struct vkd3d_scratch_buffer *scratch)
 {
-    pthread_mutex_lock(&device->mutex);
+    struct vkd3d_scratch_pool_class *pool_class;
+    struct vkd3d_scratch_buffer excess;
+    unsigned int class_index;
+    uint32_t budget;
+    bool has_excess;
 
-    if (scratch->allocation.resource.size == VKD3D_SCRATCH_BUFFER_SIZE &&
-            device->scratch_buffer_count < VKD3D_SCRATCH_BUFFER_COUNT)
+    class_index = vkd3d_scratch_pool_get_class_index(scratch->allocation.resource.size);
+
+    if (class_index >= VKD3D_SCRATCH_POOL_CLASS_COUNT ||
+            scratch->allocation.resource.size != (VKD3D_SCRATCH_BUFFER_SIZE << class_index))
     {
-        device->scratch_buffers[device->scratch_buffer_count++] = *scratch;
-        pthread_mutex_unlock(&device->mutex);
+        d3d12_device_destroy_scratch_buffer(device, scratch);
+        return;
     }
-    else
+
+    pool_class = &device->scratch_pool.classes[class_index];
+
+    pthread_mutex_lock(&device->mutex);
+
+    pool_class->in_use_count -= 1;
+    vkd3d_scratch_pool_decay(&device->scratch_pool);
+
+    /* Larger classes get to cache fewer buffers */
+    budget = max(pool_class->high_water, pool_class->window_peak);
+    budget = min(budget, max(VKD3D_SCRATCH_BUFFER_COUNT >> class_index, 1u));
+
+    if (pool_class->buffer_count + pool_class->in_use_count < budget)
     {
+        pool_class->buffers[pool_class->buffer_count++] = *scratch;
         pthread_mutex_unlock(&device->mutex);
-        d3d12_device_destroy_scratch_buffer(device, scratch);
+        return;
     }
+
+    /* Trim one more buffer at a time if the budget shrunk below what we cache */
+    if ((has_excess = pool_class->buffer_count && pool_class->buffer_count + pool_class->in_use_count > budget))
+        excess = pool_class->buffers[--pool_class->buffer_count];
+
+    pthread_mutex_unlock(&device->mutex);
+
+    d3d12_device_destroy_scratch_buffer(device, scratch);
+    if (has_excess)
+        d3d12_device_destroy_scratch_buffer(device, &excess);
 }
 
 uint64_t d3d12_device_get_descriptor_heap_gpu_va(struct d3d12_device *device)
@@ -2401,10 +2479,18 @@ static ULONG STDMETHODCALLTYPE d3d12_device_AddRef(d3d12_device_iface *iface)
 static void d3d12_device_destroy(struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    size_t i;
+    size_t i, j;
 
-    for (i = 0; i < device->scratch_buffer_count; i++)
-        d3d12_device_destroy_scratch_buffer(device, &device->scratch_buffers[i]);
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE)
+        vkd3d_pipeline_compile_pool_cleanup(&device->pipeline_compile_pool, device);
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER)
+        vkd3d_fence_worker_stop(&device->shared_fence_worker, device);
+
+    for (i = 0; i < VKD3D_SCRATCH_POOL_CLASS_COUNT; i++)
+    {
+        for (j = 0; j < device->scratch_pool.classes[i].buffer_count; j++)
+            d3d12_device_destroy_scratch_buffer(device, &device->scratch_pool.classes[i].buffers[j]);
+    }
 
     for (i = 0; i < device->query_pool_count; i++)
         d3d12_device_destroy_query_pool(device, &device->query_pools[i]);
@@ -2419,6 +2505,8 @@ static void d3d12_device_destroy(struct d3d12_device *device)
     vkd3d_view_map_destroy(&device->sampler_map, device);
     vkd3d_meta_ops_cleanup(&device->meta_ops, device);
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
+    vkd3d_memory_requirements_cache_cleanup(&device->memory_requirements_cache);
+    vkd3d_framebuffer_cache_cleanup(&device->framebuffer_cache, device);
     vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
     d3d12_device_destroy_vkd3d_queues(device);
     vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
@@ -2839,11 +2927,10 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CheckFeatureSupport(d3d12_device_i
 
         case D3D12_FEATURE_FORMAT_SUPPORT:
         {
-            const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
             D3D12_FEATURE_DATA_FORMAT_SUPPORT *data = feature_data;
             VkFormatFeatureFlagBits image_features;
             const struct vkd3d_format *format;
-            VkFormatProperties properties;
+            const VkFormatProperties *properties;
 
             if (feature_data_size != sizeof(*data))
             {
@@ -2861,12 +2948,12 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CheckFeatureSupport(d3d12_device_i
                 return E_INVALIDARG;
             }
 
-            VK_CALL(vkGetPhysicalDeviceFormatProperties(device->vk_physical_device, format->vk_format, &properties));
-            image_features = properties.linearTilingFeatures | properties.optimalTilingFeatures;
+            properties = vkd3d_get_format_properties(device, data->Format);
+            image_features = properties->linearTilingFeatures | properties->optimalTilingFeatures;
 
-            if (properties.bufferFeatures)
+            if (properties->bufferFeatures)
                 data->Support1 |= D3D12_FORMAT_SUPPORT1_BUFFER;
-            if (properties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)
+            if (properties->bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT)
                 data->Support1 |= D3D12_FORMAT_SUPPORT1_IA_VERTEX_BUFFER;
             if (data->Format == DXGI_FORMAT_R16_UINT || data->Format == DXGI_FORMAT_R32_UINT)
                 data->Support1 |= D3D12_FORMAT_SUPPORT1_IA_INDEX_BUFFER;
@@ -3450,9 +3537,11 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
     unsigned int dst_range_idx, dst_idx, src_range_idx, src_idx;
     D3D12_CPU_DESCRIPTOR_HANDLE dst, src, dst_start, src_start;
     unsigned int dst_range_size, src_range_size, copy_count;
+    struct d3d12_desc_copy_batch batch;
     unsigned int increment;
 
     increment = d3d12_device_get_descriptor_handle_increment_size(device, descriptor_heap_type);
+    d3d12_desc_copy_batch_init(&batch);
 
     dst_range_idx = dst_idx = 0;
     src_range_idx = src_idx = 0;
@@ -3475,7 +3564,7 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
             case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
                 d3d12_desc_copy(d3d12_desc_from_cpu_handle(dst),
                         d3d12_desc_from_cpu_handle(src), copy_count,
-                        descriptor_heap_type, device);
+                        descriptor_heap_type, &batch, device);
                 break;
             case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
             case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
@@ -3501,6 +3590,8 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
             src_idx = 0;
         }
     }
+
+    d3d12_desc_copy_batch_flush(&batch, device);
 }
 
 static void STDMETHODCALLTYPE d3d12_device_CopyDescriptors(d3d12_device_iface *iface,
@@ -5066,7 +5157,25 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
             goto out_cleanup_debug_ring;
     }
 
-    vkd3d_render_pass_cache_init(&device->render_pass_cache);
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER)
+    {
+        if (FAILED(hr = vkd3d_fence_worker_start(&device->shared_fence_worker, device)))
+            goto out_cleanup_descriptor_qa_global_info;
+    }
+
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE)
+    {
+        if (FAILED(hr = vkd3d_pipeline_compile_pool_init(&device->pipeline_compile_pool, device)))
+            goto out_stop_shared_fence_worker;
+    }
+
+    if (FAILED(hr = vkd3d_render_pass_cache_init(&device->render_pass_cache)))
+        goto out_cleanup_pipeline_compile_pool;
+
+    if (FAILED(hr = vkd3d_framebuffer_cache_init(&device->framebuffer_cache)))
+        goto out_cleanup_render_pass_cache;
+
+    vkd3d_memory_requirements_cache_init(&device->memory_requirements_cache);
 
     if ((device->parent = create_info->parent))
         IUnknown_AddRef(device->parent);
@@ -5074,6 +5183,17 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     d3d12_device_caps_init(device);
     return S_OK;
 
+out_cleanup_render_pass_cache:
+    vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
+out_cleanup_pipeline_compile_pool:
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE)
+        vkd3d_pipeline_compile_pool_cleanup(&device->pipeline_compile_pool, device);
+out_stop_shared_fence_worker:
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_SHARED_FENCE_WORKER)
+        vkd3d_fence_worker_stop(&device->shared_fence_worker, device);
+out_cleanup_descriptor_qa_global_info:
+    if (vkd3d_descriptor_debug_active_qa_checks())
+        vkd3d_descriptor_debug_free_global_info(device->descriptor_qa_global_info, device);
 out_cleanup_debug_ring:
     vkd3d_shader_debug_ring_cleanup(&device->debug_ring, device);
 out_cleanup_meta_ops:
@@ -23,6 +23,16 @@
 
 static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator *allocator,
         struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation);
+static bool vkd3d_memory_allocator_poll_allocation(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation, uint64_t *wait_value);
+static bool vkd3d_memory_allocator_defer_free(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation, struct vkd3d_memory_chunk *chunk, uint64_t wait_value);
+static bool vkd3d_memory_allocator_drain_magazines_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device);
+static HRESULT vkd3d_memory_allocator_start_clear_worker(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device);
+static void vkd3d_memory_allocator_stop_clear_worker(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device);
 
 static inline bool is_cpu_accessible_heap(const D3D12_HEAP_PROPERTIES *properties)
 {
@@ -496,184 +506,269 @@ static HRESULT vkd3d_memory_allocation_init(struct vkd3d_memory_allocation *allo
     return S_OK;
 }
 
-static void vkd3d_memory_chunk_insert_range(struct vkd3d_memory_chunk *chunk,
-        size_t index, VkDeviceSize offset, VkDeviceSize length)
+static void vkd3d_memory_chunk_get_size_class(VkDeviceSize size, uint32_t *fl, uint32_t *sl)
 {
-    if (!vkd3d_array_reserve((void**)&chunk->free_ranges, &chunk->free_ranges_size,
-            chunk->free_ranges_count + 1, sizeof(*chunk->free_ranges)))
+    uint32_t units = size >> VKD3D_MEMORY_CHUNK_GRANULARITY_BITS;
+    unsigned int msb;
+
+    if (units < VKD3D_MEMORY_CHUNK_SL_COUNT)
     {
-        ERR("Failed to insert free range.\n");
-        return;
+        *fl = 0;
+        *sl = units;
     }
+    else
+    {
+        msb = vkd3d_log2i(units);
+        *fl = msb - VKD3D_MEMORY_CHUNK_SL_BITS + 1;
+        *sl = (units >> (msb - VKD3D_MEMORY_CHUNK_SL_BITS)) & (VKD3D_MEMORY_CHUNK_SL_COUNT - 1);
+    }
+}
 
-    memmove(&chunk->free_ranges[index + 1], &chunk->free_ranges[index],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
-
-    chunk->free_ranges[index].offset = offset;
-    chunk->free_ranges[index].length = length;
-    chunk->free_ranges_count++;
+static bool vkd3d_memory_chunk_reserve_blocks(struct vkd3d_memory_chunk *chunk, size_t count)
+{
+    return vkd3d_array_reserve((void**)&chunk->blocks, &chunk->blocks_size,
+            chunk->blocks_count + count, sizeof(*chunk->blocks));
 }
 
-static void vkd3d_memory_chunk_remove_range(struct vkd3d_memory_chunk *chunk, size_t index)
+static uint32_t vkd3d_memory_chunk_create_block(struct vkd3d_memory_chunk *chunk)
 {
-    chunk->free_ranges_count--;
+    uint32_t index;
 
-    memmove(&chunk->free_ranges[index], &chunk->free_ranges[index + 1],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
+    /* Callers must reserve enough space up front, so this cannot fail */
+    if ((index = chunk->unused_block) != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+        chunk->unused_block = chunk->blocks[index].next_free;
+    else
+        index = chunk->blocks_count++;
+
+    assert(index < chunk->blocks_size);
+    return index;
 }
 
-static HRESULT vkd3d_memory_chunk_allocate_range(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements,
-        struct vkd3d_memory_allocation *allocation)
+static void vkd3d_memory_chunk_destroy_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
 {
-    struct vkd3d_memory_free_range *pick_range;
-    VkDeviceSize l_length, r_length;
-    size_t i, pick_index;
+    chunk->blocks[index].next_free = chunk->unused_block;
+    chunk->unused_block = index;
+}
 
-    if (!chunk->free_ranges_count)
-        return E_OUTOFMEMORY;
+static void vkd3d_memory_chunk_insert_free_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
+{
+    struct vkd3d_memory_chunk_block *block = &chunk->blocks[index];
+    uint32_t fl, sl, head;
 
-    pick_index = chunk->free_ranges_count;
-    pick_range = NULL;
+    vkd3d_memory_chunk_get_size_class(block->length, &fl, &sl);
+    head = chunk->free_lists[fl][sl];
 
-    for (i = 0; i < chunk->free_ranges_count; i++)
-    {
-        struct vkd3d_memory_free_range *range = &chunk->free_ranges[i];
+    block->is_free = true;
+    block->prev_free = VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+    block->next_free = head;
 
-        if (range->offset + range->length < align(range->offset, memory_requirements->alignment) + memory_requirements->size)
-            continue;
+    if (head != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+        chunk->blocks[head].prev_free = index;
 
-        /* Exact fit leaving no gaps */
-        if (range->length == memory_requirements->size)
-        {
-            pick_index = i;
-            pick_range = range;
-            break;
-        }
+    chunk->free_lists[fl][sl] = index;
+    chunk->sl_masks[fl] |= 1u << sl;
+    chunk->fl_mask |= 1u << fl;
+}
 
-        /* Alignment is almost always going to be 64 KiB, so
-         * don't worry too much about misalignment gaps here */
-        if (!pick_range || range->length > pick_range->length)
-        {
-            pick_index = i;
-            pick_range = range;
-        }
-    }
+static void vkd3d_memory_chunk_remove_free_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
+{
+    struct vkd3d_memory_chunk_block *block = &chunk->blocks[index];
+    uint32_t fl, sl;
 
-    if (!pick_range)
-        return E_OUTOFMEMORY;
+    vkd3d_memory_chunk_get_size_class(block->length, &fl, &sl);
 
-    /* Adjust offsets and addresses of the base allocation */
-    vkd3d_memory_allocation_slice(allocation, &chunk->allocation,
-            align(pick_range->offset, memory_requirements->alignment),
-            memory_requirements->size);
-    allocation->chunk = chunk;
+    if (block->prev_free != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+        chunk->blocks[block->prev_free].next_free = block->next_free;
+    else
+        chunk->free_lists[fl][sl] = block->next_free;
 
-    /* Remove allocated range from the free list */
-    l_length = allocation->offset - pick_range->offset;
-    r_length = pick_range->offset + pick_range->length
-            - allocation->offset - allocation->resource.size;
+    if (block->next_free != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+        chunk->blocks[block->next_free].prev_free = block->prev_free;
 
-    if (l_length)
+    if (chunk->free_lists[fl][sl] == VKD3D_MEMORY_CHUNK_BLOCK_NONE)
     {
-        pick_range->length = l_length;
+        chunk->sl_masks[fl] &= ~(1u << sl);
 
-        if (r_length)
-        {
-            vkd3d_memory_chunk_insert_range(chunk, pick_index + 1,
-                allocation->offset + allocation->resource.size, r_length);
-        }
-    }
-    else if (r_length)
-    {
-        pick_range->offset = allocation->offset + allocation->resource.size;
-        pick_range->length = r_length;
-    }
-    else
-    {
-        vkd3d_memory_chunk_remove_range(chunk, pick_index);
+        if (!chunk->sl_masks[fl])
+            chunk->fl_mask &= ~(1u << fl);
     }
 
-    return S_OK;
+    block->is_free = false;
 }
 
-static size_t vkd3d_memory_chunk_find_range(struct vkd3d_memory_chunk *chunk, VkDeviceSize offset)
+static uint32_t vkd3d_memory_chunk_find_free_block(struct vkd3d_memory_chunk *chunk, VkDeviceSize size)
 {
-    struct vkd3d_memory_free_range *range;
-    size_t index, hi, lo;
+    uint32_t fl, sl, sl_mask, fl_mask;
+    VkDeviceSize units;
+
+    /* Round the size up to the next size class boundary so that
+     * any block in the class we end up picking is large enough */
+    units = size >> VKD3D_MEMORY_CHUNK_GRANULARITY_BITS;
 
-    lo = 0;
-    hi = chunk->free_ranges_count;
+    if (units >= VKD3D_MEMORY_CHUNK_SL_COUNT)
+        size += (VKD3D_MEMORY_CHUNK_GRANULARITY << (vkd3d_log2i(units) - VKD3D_MEMORY_CHUNK_SL_BITS)) - 1;
 
-    while (lo < hi)
+    if (size > chunk->allocation.resource.size)
+        return VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+
+    vkd3d_memory_chunk_get_size_class(size, &fl, &sl);
+
+    if (!(sl_mask = chunk->sl_masks[fl] & (~0u << sl)))
     {
-        index = lo + (hi - lo) / 2;
-        range = &chunk->free_ranges[index];
+        if (!(fl_mask = chunk->fl_mask & (~0u << (fl + 1))))
+            return VKD3D_MEMORY_CHUNK_BLOCK_NONE;
 
-        if (range->offset > offset)
-            hi = index;
-        else
-            lo = index + 1;
+        fl = vkd3d_bitmask_tzcnt32(fl_mask);
+        sl_mask = chunk->sl_masks[fl];
     }
 
-    return lo;
+    sl = vkd3d_bitmask_tzcnt32(sl_mask);
+    return chunk->free_lists[fl][sl];
 }
 
-static void vkd3d_memory_chunk_free_range(struct vkd3d_memory_chunk *chunk, const struct vkd3d_memory_allocation *allocation)
+static bool vkd3d_memory_chunk_block_fits(const struct vkd3d_memory_chunk_block *block,
+        VkDeviceSize size, VkDeviceSize alignment)
 {
-    struct vkd3d_memory_free_range *range;
-    bool adjacent_l, adjacent_r;
-    size_t index;
+    return align(block->offset, alignment) + size <= block->offset + block->length;
+}
 
-    index = vkd3d_memory_chunk_find_range(chunk, allocation->offset);
+static HRESULT vkd3d_memory_chunk_allocate_range(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements,
+        struct vkd3d_memory_allocation *allocation)
+{
+    VkDeviceSize alignment, size, offset, l_length, r_length;
+    struct vkd3d_memory_chunk_block *block, *split;
+    uint32_t index, split_index;
 
-    adjacent_l = false;
-    adjacent_r = false;
+    alignment = max(memory_requirements->alignment, VKD3D_MEMORY_CHUNK_GRANULARITY);
+    size = align(memory_requirements->size, VKD3D_MEMORY_CHUNK_GRANULARITY);
 
-    if (index > 0)
+    if (size > chunk->free_size)
+        return E_OUTOFMEMORY;
+
+    /* Alignment is almost always going to be 64 KiB, and free blocks are
+     * usually aligned to that already. Only pad the request to guarantee
+     * an aligned fit if the first candidate block does not work out. */
+    index = vkd3d_memory_chunk_find_free_block(chunk, size);
+
+    if (index == VKD3D_MEMORY_CHUNK_BLOCK_NONE || !vkd3d_memory_chunk_block_fits(&chunk->blocks[index], size, alignment))
     {
-        range = &chunk->free_ranges[index - 1];
-        adjacent_l = range->offset + range->length == allocation->offset;
+        if (alignment == VKD3D_MEMORY_CHUNK_GRANULARITY)
+            return E_OUTOFMEMORY;
+
+        index = vkd3d_memory_chunk_find_free_block(chunk, size + alignment - VKD3D_MEMORY_CHUNK_GRANULARITY);
+
+        if (index == VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+            return E_OUTOFMEMORY;
     }
 
-    if (index < chunk->free_ranges_count)
+    /* We may have to split off a block on either side */
+    if (!vkd3d_memory_chunk_reserve_blocks(chunk, 2))
     {
-        range = &chunk->free_ranges[index];
-        adjacent_r = range->offset == allocation->offset + allocation->resource.size;
+        ERR("Failed to allocate block.\n");
+        return E_OUTOFMEMORY;
     }
 
-    if (adjacent_l)
+    vkd3d_memory_chunk_remove_free_block(chunk, index);
+
+    block = &chunk->blocks[index];
+    offset = align(block->offset, alignment);
+    l_length = offset - block->offset;
+    r_length = block->offset + block->length - offset - size;
+
+    if (l_length)
     {
-        range = &chunk->free_ranges[index - 1];
-        range->length += allocation->resource.size;
+        split_index = vkd3d_memory_chunk_create_block(chunk);
+        split = &chunk->blocks[split_index];
+        split->offset = block->offset;
+        split->length = l_length;
+        split->prev_phys = block->prev_phys;
+        split->next_phys = index;
+
+        if (block->prev_phys != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+            chunk->blocks[block->prev_phys].next_phys = split_index;
+
+        block->prev_phys = split_index;
+        vkd3d_memory_chunk_insert_free_block(chunk, split_index);
+    }
 
-        if (adjacent_r)
-        {
-            range->length += chunk->free_ranges[index].length;
-            vkd3d_memory_chunk_remove_range(chunk, index);
-        }
+    if (r_length)
+    {
+        split_index = vkd3d_memory_chunk_create_block(chunk);
+        split = &chunk->blocks[split_index];
+        split->offset = offset + size;
+        split->length = r_length;
+        split->prev_phys = index;
+        split->next_phys = block->next_phys;
+
+        if (block->next_phys != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+            chunk->blocks[block->next_phys].prev_phys = split_index;
+
+        block->next_phys = split_index;
+        vkd3d_memory_chunk_insert_free_block(chunk, split_index);
     }
-    else if (adjacent_r)
+
+    block->offset = offset;
+    block->length = size;
+    chunk->free_size -= size;
+
+    /* Adjust offsets and addresses of the base allocation */
+    vkd3d_memory_allocation_slice(allocation, &chunk->allocation, offset, memory_requirements->size);
+    allocation->chunk = chunk;
+    allocation->chunk_block = index;
+    return S_OK;
+}
+
+static void vkd3d_memory_chunk_merge_block(struct vkd3d_memory_chunk *chunk, uint32_t index, uint32_t next_index)
+{
+    struct vkd3d_memory_chunk_block *block = &chunk->blocks[index];
+    struct vkd3d_memory_chunk_block *next = &chunk->blocks[next_index];
+
+    block->length += next->length;
+    block->next_phys = next->next_phys;
+
+    if (next->next_phys != VKD3D_MEMORY_CHUNK_BLOCK_NONE)
+        chunk->blocks[next->next_phys].prev_phys = index;
+
+    vkd3d_memory_chunk_destroy_block(chunk, next_index);
+}
+
+static void vkd3d_memory_chunk_free_range(struct vkd3d_memory_chunk *chunk, const struct vkd3d_memory_allocation *allocation)
+{
+    uint32_t index = allocation->chunk_block;
+    struct vkd3d_memory_chunk_block *block;
+    uint32_t neighbour;
+
+    block = &chunk->blocks[index];
+    chunk->free_size += block->length;
+
+    if ((neighbour = block->prev_phys) != VKD3D_MEMORY_CHUNK_BLOCK_NONE && chunk->blocks[neighbour].is_free)
     {
-        range = &chunk->free_ranges[index];
-        range->offset = allocation->offset;
-        range->length += allocation->resource.size;
+        vkd3d_memory_chunk_remove_free_block(chunk, neighbour);
+        vkd3d_memory_chunk_merge_block(chunk, neighbour, index);
+        index = neighbour;
+        block = &chunk->blocks[index];
     }
-    else
+
+    if ((neighbour = block->next_phys) != VKD3D_MEMORY_CHUNK_BLOCK_NONE && chunk->blocks[neighbour].is_free)
     {
-        vkd3d_memory_chunk_insert_range(chunk, index,
-                allocation->offset, allocation->resource.size);
+        vkd3d_memory_chunk_remove_free_block(chunk, neighbour);
+        vkd3d_memory_chunk_merge_block(chunk, index, neighbour);
     }
+
+    vkd3d_memory_chunk_insert_free_block(chunk, index);
 }
 
 static bool vkd3d_memory_chunk_is_free(struct vkd3d_memory_chunk *chunk)
 {
-    return chunk->free_ranges_count == 1 && chunk->free_ranges[0].length == chunk->allocation.resource.size;
+    return chunk->free_size == chunk->allocation.resource.size;
 }
 
 static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
         const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_chunk **chunk)
 {
+    struct vkd3d_memory_chunk_block *block;
     struct vkd3d_memory_chunk *object;
+    uint32_t index, i, j;
     HRESULT hr;
 
     TRACE("device %p, allocator %p, info %p, chunk %p.\n", device, allocator, info, chunk);
@@ -682,20 +777,49 @@ static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd
         return E_OUTOFMEMORY;
 
     memset(object, 0, sizeof(*object));
+    object->unused_block = VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+
+    for (i = 0; i < VKD3D_MEMORY_CHUNK_FL_COUNT; i++)
+    {
+        for (j = 0; j < VKD3D_MEMORY_CHUNK_SL_COUNT; j++)
+            object->free_lists[i][j] = VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+    }
+
+    if (!vkd3d_memory_chunk_reserve_blocks(object, 1))
+    {
+        vkd3d_free(object);
+        return E_OUTOFMEMORY;
+    }
 
     if (FAILED(hr = vkd3d_memory_allocation_init(&object->allocation, device, allocator, info)))
     {
+        vkd3d_free(object->blocks);
         vkd3d_free(object);
         return hr;
     }
 
-    vkd3d_memory_chunk_insert_range(object, 0, 0, object->allocation.resource.size);
+    index = vkd3d_memory_chunk_create_block(object);
+    block = &object->blocks[index];
+    block->offset = 0;
+    block->length = object->allocation.resource.size;
+    block->prev_phys = VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+    block->next_phys = VKD3D_MEMORY_CHUNK_BLOCK_NONE;
+    vkd3d_memory_chunk_insert_free_block(object, index);
+
+    object->free_size = object->allocation.resource.size;
     *chunk = object;
 
     TRACE("Created chunk %p (allocation %p).\n", object, &object->allocation);
     return S_OK;
 }
 
+static void vkd3d_memory_chunk_free(struct vkd3d_memory_chunk *chunk, struct d3d12_device *device, struct vkd3d_memory_allocator *allocator)
+{
+    vkd3d_memory_allocation_free(&chunk->allocation, device, allocator);
+    vkd3d_free(chunk->blocks);
+    vkd3d_free(chunk);
+}
+
 static void vkd3d_memory_chunk_destroy(struct vkd3d_memory_chunk *chunk, struct d3d12_device *device, struct vkd3d_memory_allocator *allocator)
 {
     TRACE("chunk %p, device %p, allocator %p.\n", chunk, device, allocator);
@@ -703,24 +827,72 @@ static void vkd3d_memory_chunk_destroy(struct vkd3d_memory_chunk *chunk, struct
     if (chunk->allocation.clear_semaphore_value)
         vkd3d_memory_allocator_wait_allocation(allocator, device, &chunk->allocation);
 
-    vkd3d_memory_allocation_free(&chunk->allocation, device, allocator);
-    vkd3d_free(chunk->free_ranges);
-    vkd3d_free(chunk);
+    vkd3d_memory_chunk_free(chunk, device, allocator);
+}
+
+static struct vkd3d_memory_chunk_bucket *vkd3d_memory_allocator_find_chunk_bucket(struct vkd3d_memory_allocator *allocator,
+        D3D12_HEAP_TYPE heap_type, D3D12_HEAP_FLAGS heap_flags, uint32_t vk_memory_type)
+{
+    struct vkd3d_memory_chunk_bucket *bucket;
+    size_t i;
+
+    for (i = 0; i < allocator->chunk_buckets_count; i++)
+    {
+        bucket = &allocator->chunk_buckets[i];
+
+        if (bucket->heap_type == heap_type && bucket->heap_flags == heap_flags &&
+                bucket->vk_memory_type == vk_memory_type)
+            return bucket;
+    }
+
+    return NULL;
+}
+
+static struct vkd3d_memory_chunk_bucket *vkd3d_memory_allocator_get_chunk_bucket(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_chunk *chunk)
+{
+    struct vkd3d_memory_chunk_bucket *bucket;
+
+    if ((bucket = vkd3d_memory_allocator_find_chunk_bucket(allocator, chunk->allocation.heap_type,
+            chunk->allocation.heap_flags, chunk->allocation.vk_memory_type)))
+        return bucket;
+
+    if (!vkd3d_array_reserve((void**)&allocator->chunk_buckets, &allocator->chunk_buckets_size,
+            allocator->chunk_buckets_count + 1, sizeof(*allocator->chunk_buckets)))
+        return NULL;
+
+    bucket = &allocator->chunk_buckets[allocator->chunk_buckets_count++];
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->heap_type = chunk->allocation.heap_type;
+    bucket->heap_flags = chunk->allocation.heap_flags;
+    bucket->vk_memory_type = chunk->allocation.vk_memory_type;
+    return bucket;
 }
 
 static void vkd3d_memory_allocator_remove_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device, struct vkd3d_memory_chunk *chunk)
 {
+    struct vkd3d_memory_chunk_bucket *bucket;
+    uint64_t wait_value;
     size_t i;
 
-    for (i = 0; i < allocator->chunks_count; i++)
+    bucket = vkd3d_memory_allocator_find_chunk_bucket(allocator, chunk->allocation.heap_type,
+            chunk->allocation.heap_flags, chunk->allocation.vk_memory_type);
+
+    for (i = 0; i < bucket->chunks_count; i++)
     {
-        if (allocator->chunks[i] == chunk)
+        if (bucket->chunks[i] == chunk)
         {
-            allocator->chunks[i] = allocator->chunks[--allocator->chunks_count];
+            bucket->chunks[i] = bucket->chunks[--bucket->chunks_count];
             break;
         }
     }
 
+    /* Do not stall the freeing thread if the chunk is still being cleared */
+    if (chunk->allocation.clear_semaphore_value &&
+            !vkd3d_memory_allocator_poll_allocation(allocator, device, &chunk->allocation, &wait_value) &&
+            vkd3d_memory_allocator_defer_free(allocator, &chunk->allocation, chunk, wait_value))
+        return;
+
     vkd3d_memory_chunk_destroy(chunk, device, allocator);
 }
 
@@ -732,16 +904,65 @@ static void vkd3d_memory_allocator_cleanup_clear_queue(struct vkd3d_memory_alloc
     VK_CALL(vkDestroyCommandPool(device->vk_device, clear_queue->vk_command_pool, NULL));
     VK_CALL(vkDestroySemaphore(device->vk_device, clear_queue->vk_semaphore, NULL));
 
-    vkd3d_free(clear_queue->allocations);
+    TRACE("Cleared %"PRIu64" bytes of suballocated memory, skipped %"PRIu64" bytes.\n",
+            clear_queue->num_bytes_cleared, clear_queue->num_bytes_skipped);
+    TRACE("Used %zu clear command buffers.\n", clear_queue->command_buffers_count);
+
+    vkd3d_free(clear_queue->command_buffers);
+    vkd3d_free(clear_queue->deferred_frees);
+    vkd3d_free(clear_queue->ranges);
+    pthread_cond_destroy(&clear_queue->cond);
     pthread_mutex_destroy(&clear_queue->mutex);
 }
 
+static HRESULT vkd3d_memory_clear_queue_insert_command_buffers(struct vkd3d_memory_clear_queue *clear_queue,
+        struct d3d12_device *device, size_t index, uint32_t count)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkCommandBuffer vk_command_buffers[VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT];
+    VkCommandBufferAllocateInfo command_buffer_info;
+    uint32_t i;
+    VkResult vr;
+
+    assert(count <= ARRAY_SIZE(vk_command_buffers));
+
+    if (!vkd3d_array_reserve((void**)&clear_queue->command_buffers, &clear_queue->command_buffers_size,
+            clear_queue->command_buffers_count + count, sizeof(*clear_queue->command_buffers)))
+        return E_OUTOFMEMORY;
+
+    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    command_buffer_info.pNext = NULL;
+    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    command_buffer_info.commandPool = clear_queue->vk_command_pool;
+    command_buffer_info.commandBufferCount = count;
+
+    if ((vr = VK_CALL(vkAllocateCommandBuffers(device->vk_device,
+            &command_buffer_info, vk_command_buffers))) < 0)
+    {
+        ERR("Failed to allocate command buffer, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    /* Inserting at the current ring position keeps the remaining
+     * command buffers ordered by their signal value. */
+    memmove(&clear_queue->command_buffers[index + count], &clear_queue->command_buffers[index],
+            (clear_queue->command_buffers_count - index) * sizeof(*clear_queue->command_buffers));
+
+    for (i = 0; i < count; i++)
+    {
+        clear_queue->command_buffers[index + i].vk_command_buffer = vk_command_buffers[i];
+        clear_queue->command_buffers[index + i].signal_value = 0;
+    }
+
+    clear_queue->command_buffers_count += count;
+    return S_OK;
+}
+
 static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkSemaphoreTypeCreateInfoKHR semaphore_type_info;
-    VkCommandBufferAllocateInfo command_buffer_info;
     VkCommandPoolCreateInfo command_pool_info;
     VkSemaphoreCreateInfo semaphore_info;
     VkResult vr;
@@ -753,9 +974,15 @@ static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_alloc
     clear_queue->last_known_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT;
     clear_queue->next_signal_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT + 1;
 
-    if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
+    if ((rc = pthread_mutex_init(&clear_queue->mutex, NULL)))
         return hresult_from_errno(rc);
 
+    if ((rc = pthread_cond_init(&clear_queue->cond, NULL)))
+    {
+        pthread_mutex_destroy(&clear_queue->mutex);
+        return hresult_from_errno(rc);
+    }
+
     command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     command_pool_info.pNext = NULL;
     command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
@@ -769,19 +996,9 @@ static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_alloc
         goto fail;
     }
 
-    command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    command_buffer_info.pNext = NULL;
-    command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    command_buffer_info.commandPool = clear_queue->vk_command_pool;
-    command_buffer_info.commandBufferCount = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT;
-
-    if ((vr = VK_CALL(vkAllocateCommandBuffers(device->vk_device,
-            &command_buffer_info, clear_queue->vk_command_buffers))) < 0)
-    {
-        ERR("Failed to allocate command buffer, vr %d.\n", vr);
-        hr = hresult_from_vk_result(vr);
+    if (FAILED(hr = vkd3d_memory_clear_queue_insert_command_buffers(clear_queue,
+            device, 0, VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT)))
         goto fail;
-    }
 
     semaphore_type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
     semaphore_type_info.pNext = NULL;
@@ -809,6 +1026,7 @@ fail:
 
 HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
+    unsigned int i;
     HRESULT hr;
     int rc;
 
@@ -817,6 +1035,9 @@ HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, st
     if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
         return hresult_from_errno(rc);
 
+    for (i = 0; i < VKD3D_MEMORY_MAGAZINE_SHARD_COUNT; i++)
+        spinlock_init(&allocator->magazine_shards[i].lock);
+
     if (FAILED(hr = vkd3d_memory_allocator_init_clear_queue(allocator, device)))
     {
         pthread_mutex_destroy(&allocator->mutex);
@@ -827,17 +1048,38 @@ HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, st
 
     allocator->vkd3d_queue = d3d12_device_allocate_vkd3d_queue(device,
             device->queue_families[VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE]);
+
+    /* Without the worker, clears are flushed inline once enough of them are
+     * pending and frees wait for their clears to complete instead. */
+    if (FAILED(vkd3d_memory_allocator_start_clear_worker(allocator, device)))
+        WARN("Falling back to inline memory clears.\n");
+
     return S_OK;
 }
 
 void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
-    size_t i;
+    struct vkd3d_memory_chunk_bucket *bucket;
+    size_t i, j;
+
+    vkd3d_memory_allocator_stop_clear_worker(allocator, device);
+
+    for (i = 0; i < allocator->chunk_buckets_count; i++)
+    {
+        bucket = &allocator->chunk_buckets[i];
+
+        for (j = 0; j < bucket->chunks_count; j++)
+            vkd3d_memory_chunk_destroy(bucket->chunks[j], device, allocator);
+
+        vkd3d_free(bucket->chunks);
+    }
 
-    for (i = 0; i < allocator->chunks_count; i++)
-        vkd3d_memory_chunk_destroy(allocator->chunks[i], device, allocator);
+    vkd3d_free(allocator->chunk_buckets);
+
+    /* Cached ranges are owned by the chunks we just destroyed */
+    for (i = 0; i < VKD3D_MEMORY_MAGAZINE_SHARD_COUNT; i++)
+        vkd3d_free(allocator->magazine_shards[i].magazines);
 
-    vkd3d_free(allocator->chunks);
     vkd3d_va_map_cleanup(&allocator->va_map);
     vkd3d_memory_allocator_cleanup_clear_queue(allocator, device);
     pthread_mutex_destroy(&allocator->mutex);
@@ -895,12 +1137,25 @@ static bool vkd3d_memory_allocator_wait_clear_semaphore(struct vkd3d_memory_allo
     return new_value >= wait_value;
 }
 
+static int vkd3d_memory_clear_range_compare(const void *a, const void *b)
+{
+    const struct vkd3d_memory_clear_range *range_a = a;
+    const struct vkd3d_memory_clear_range *range_b = b;
+
+    if (range_a->vk_buffer != range_b->vk_buffer)
+        return range_a->vk_buffer < range_b->vk_buffer ? -1 : 1;
+    if (range_a->offset != range_b->offset)
+        return range_a->offset < range_b->offset ? -1 : 1;
+    return 0;
+}
+
 static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_allocator *allocator,
         struct d3d12_device *device)
 {
     const VkPipelineStageFlags vk_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_memory_clear_command_buffer *command_buffer;
     VkTimelineSemaphoreSubmitInfoKHR timeline_info;
     struct vkd3d_queue_family_info *queue_family;
     VkCommandBufferBeginInfo begin_info;
@@ -909,18 +1164,27 @@ static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_al
     VkSubmitInfo submit_info;
     VkQueue vk_queue;
     VkResult vr;
+    HRESULT hr;
     size_t i;
 
-    if (!clear_queue->allocations_count)
+    if (!clear_queue->ranges_count)
         return S_OK;
 
     /* Record commands late so that we can simply remove allocations from
      * the queue if they got freed before the clear commands got dispatched,
-     * rather than rewriting the command buffer or dispatching the clear */
-    vk_cmd_buffer = clear_queue->vk_command_buffers[clear_queue->command_buffer_index];
+     * rather than rewriting the command buffer or dispatching the clear.
+     * The command buffer at the current ring position is the oldest one,
+     * if it is still in flight, grow the ring instead of stalling. */
+    if (!vkd3d_memory_allocator_wait_clear_semaphore(allocator, device,
+            clear_queue->command_buffers[clear_queue->command_buffer_index].signal_value, 0))
+    {
+        if (FAILED(hr = vkd3d_memory_clear_queue_insert_command_buffers(clear_queue,
+                device, clear_queue->command_buffer_index, 1)))
+            return hr;
+    }
 
-    vkd3d_memory_allocator_wait_clear_semaphore(allocator, device,
-            clear_queue->next_signal_value - VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT, UINT64_MAX);
+    command_buffer = &clear_queue->command_buffers[clear_queue->command_buffer_index];
+    vk_cmd_buffer = command_buffer->vk_command_buffer;
 
     if ((vr = VK_CALL(vkResetCommandBuffer(vk_cmd_buffer, 0))))
     {
@@ -939,12 +1203,26 @@ static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_al
         return hresult_from_vk_result(vr);
     }
 
-    for (i = 0; i < clear_queue->allocations_count; i++)
+    /* Merge ranges which are adjacent in the same buffer, which is common
+     * for suballocations carved from the same chunk in a row */
+    qsort(clear_queue->ranges, clear_queue->ranges_count,
+            sizeof(*clear_queue->ranges), vkd3d_memory_clear_range_compare);
+
+    for (i = 0; i < clear_queue->ranges_count; i++)
     {
-        const struct vkd3d_memory_allocation *allocation = clear_queue->allocations[i];
+        const struct vkd3d_memory_clear_range *range = &clear_queue->ranges[i];
+        VkDeviceSize offset = range->offset;
+        VkDeviceSize end = range->offset + range->size;
+
+        while (i + 1 < clear_queue->ranges_count &&
+                clear_queue->ranges[i + 1].vk_buffer == range->vk_buffer &&
+                clear_queue->ranges[i + 1].offset <= end)
+        {
+            i++;
+            end = max(end, clear_queue->ranges[i].offset + clear_queue->ranges[i].size);
+        }
 
-        VK_CALL(vkCmdFillBuffer(vk_cmd_buffer, allocation->resource.vk_buffer,
-                allocation->offset, allocation->resource.size, 0));
+        VK_CALL(vkCmdFillBuffer(vk_cmd_buffer, range->vk_buffer, offset, end - offset, 0));
     }
 
     if ((vr = VK_CALL(vkEndCommandBuffer(vk_cmd_buffer))) < 0)
@@ -1008,11 +1286,12 @@ static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_al
     }
 
     /* Keep next_signal always one ahead of the last signaled value */
+    command_buffer->signal_value = clear_queue->next_signal_value;
     clear_queue->next_signal_value += 1;
     clear_queue->num_bytes_pending = 0;
-    clear_queue->allocations_count = 0;
+    clear_queue->ranges_count = 0;
     clear_queue->command_buffer_index += 1;
-    clear_queue->command_buffer_index %= VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT;
+    clear_queue->command_buffer_index %= clear_queue->command_buffers_count;
     return S_OK;
 }
 
@@ -1029,10 +1308,93 @@ HRESULT vkd3d_memory_allocator_flush_clears(struct vkd3d_memory_allocator *alloc
 
 #define VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES (256ull << 20) /* 256 MiB */
 
+static bool vkd3d_memory_clear_queue_add_range_locked(struct vkd3d_memory_clear_queue *clear_queue,
+        const struct vkd3d_memory_allocation *allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    struct vkd3d_memory_clear_range *range;
+
+    if (!vkd3d_array_reserve((void**)&clear_queue->ranges, &clear_queue->ranges_size,
+            clear_queue->ranges_count + 1, sizeof(*clear_queue->ranges)))
+    {
+        ERR("Failed to insert clear range.\n");
+        return false;
+    }
+
+    range = &clear_queue->ranges[clear_queue->ranges_count++];
+    range->allocation = allocation;
+    range->vk_buffer = allocation->resource.vk_buffer;
+    range->offset = offset;
+    range->size = size;
+
+    clear_queue->num_bytes_pending += size;
+    clear_queue->num_bytes_cleared += size;
+    return true;
+}
+
+static inline bool vkd3d_memory_chunk_test_and_set_dirty_page(struct vkd3d_memory_chunk *chunk, uint32_t page)
+{
+    uint64_t mask = 1ull << (page & 63);
+    bool dirty = !!(chunk->dirty_pages[page / 64] & mask);
+
+    chunk->dirty_pages[page / 64] |= mask;
+    return dirty;
+}
+
+static bool vkd3d_memory_allocator_clear_chunk_range_locked(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation, bool clear)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    VkDeviceSize start, end, page_start, page_end, span_start, span_end;
+    const struct vkd3d_memory_chunk *chunk = allocation->chunk;
+    uint32_t page, first_page, last_page;
+    bool queued = false;
+
+    start = allocation->offset - chunk->allocation.offset;
+    end = start + allocation->resource.size;
+    first_page = start >> VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS;
+    last_page = (end - 1) >> VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS;
+    span_start = span_end = start;
+
+    /* Pages which have never been handed out still hold the zeroes from
+     * the initial chunk clear, only clear the parts that are dirty. */
+    for (page = first_page; page <= last_page; page++)
+    {
+        page_start = max(start, (VkDeviceSize)page << VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS);
+        page_end = min(end, (VkDeviceSize)(page + 1) << VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS);
+
+        if (vkd3d_memory_chunk_test_and_set_dirty_page(allocation->chunk, page))
+        {
+            if (span_end != page_start)
+            {
+                if (clear && span_end > span_start)
+                {
+                    queued |= vkd3d_memory_clear_queue_add_range_locked(clear_queue, allocation,
+                            chunk->allocation.offset + span_start, span_end - span_start);
+                }
+
+                span_start = page_start;
+            }
+
+            span_end = page_end;
+        }
+        else if (clear)
+            clear_queue->num_bytes_skipped += page_end - page_start;
+    }
+
+    if (clear && span_end > span_start)
+    {
+        queued |= vkd3d_memory_clear_queue_add_range_locked(clear_queue, allocation,
+                chunk->allocation.offset + span_start, span_end - span_start);
+    }
+
+    return queued;
+}
+
 static void vkd3d_memory_allocator_clear_allocation(struct vkd3d_memory_allocator *allocator,
         struct d3d12_device *device, struct vkd3d_memory_allocation *allocation)
 {
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    bool queued;
 
     if (allocation->cpu_address)
     {
@@ -1044,69 +1406,101 @@ static void vkd3d_memory_allocator_clear_allocation(struct vkd3d_memory_allocato
     {
         pthread_mutex_lock(&clear_queue->mutex);
 
-        if (!vkd3d_array_reserve((void**)&clear_queue->allocations, &clear_queue->allocations_size,
-                clear_queue->allocations_count + 1, sizeof(*clear_queue->allocations)))
-        {
-            ERR("Failed to insert free range.\n");
-            pthread_mutex_unlock(&clear_queue->mutex);
-            return;
-        }
-
-        allocation->clear_semaphore_value = clear_queue->next_signal_value;
-
         if (allocation->chunk)
-            allocation->chunk->allocation.clear_semaphore_value = clear_queue->next_signal_value;
+            queued = vkd3d_memory_allocator_clear_chunk_range_locked(allocator, allocation, true);
+        else
+            queued = vkd3d_memory_clear_queue_add_range_locked(clear_queue, allocation, allocation->offset, allocation->resource.size);
 
-        clear_queue->allocations[clear_queue->allocations_count++] = allocation;
-        clear_queue->num_bytes_pending += allocation->resource.size;
+        if (queued)
+        {
+            allocation->clear_semaphore_value = clear_queue->next_signal_value;
+
+            if (allocation->chunk)
+                allocation->chunk->allocation.clear_semaphore_value = clear_queue->next_signal_value;
+        }
 
+        /* Let the clear worker submit large batches so that resource
+         * creation does not have to record and submit commands. */
         if (clear_queue->num_bytes_pending >= VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES)
-            vkd3d_memory_allocator_flush_clears_locked(allocator, device);
+        {
+            if (clear_queue->worker_running)
+                pthread_cond_signal(&clear_queue->cond);
+            else
+                vkd3d_memory_allocator_flush_clears_locked(allocator, device);
+        }
 
         pthread_mutex_unlock(&clear_queue->mutex);
     }
 }
 
-static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator *allocator,
-        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+static void vkd3d_memory_allocator_mark_allocation_dirty(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+
+    /* The application may write to memory it did not ask to be zeroed,
+     * so subsequent suballocations overlapping it must be cleared */
+    pthread_mutex_lock(&clear_queue->mutex);
+    vkd3d_memory_allocator_clear_chunk_range_locked(allocator, allocation, false);
+    pthread_mutex_unlock(&clear_queue->mutex);
+}
+
+static bool vkd3d_memory_allocator_poll_allocation(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation, uint64_t *wait_value)
 {
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
-    uint64_t wait_value = allocation->clear_semaphore_value;
+    bool found;
     size_t i;
 
+    *wait_value = allocation->clear_semaphore_value;
+
     /* If the clear semaphore has been signaled to the expected value,
      * the GPU is already done clearing the allocation, and it cannot
      * be in the clear queue either, so there is nothing to do. */
-    if (vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, 0))
-        return;
+    if (vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, *wait_value, 0))
+        return true;
 
     /* If the allocation is still in the queue, the GPU has not started
      * using it yet so we can remove it from the queue and exit. */
     pthread_mutex_lock(&clear_queue->mutex);
+    found = false;
 
-    for (i = 0; i < clear_queue->allocations_count; i++)
+    for (i = clear_queue->ranges_count; i; i--)
     {
-        if (clear_queue->allocations[i] == allocation)
+        if (clear_queue->ranges[i - 1].allocation == allocation)
         {
-            clear_queue->allocations[i] = clear_queue->allocations[--clear_queue->allocations_count];
-            clear_queue->num_bytes_pending -= allocation->resource.size;
-            pthread_mutex_unlock(&clear_queue->mutex);
-            return;
+            clear_queue->num_bytes_pending -= clear_queue->ranges[i - 1].size;
+            clear_queue->ranges[i - 1] = clear_queue->ranges[--clear_queue->ranges_count];
+            found = true;
         }
     }
 
+    if (found)
+    {
+        pthread_mutex_unlock(&clear_queue->mutex);
+        return true;
+    }
+
     /* If this is a chunk and a suballocation from it had been immediately
      * freed, it is possible that the suballocation got removed from the
      * clear queue so that the chunk's wait value never gets signaled. Wait
      * for the last signaled value in that case. */
-    if (wait_value == clear_queue->next_signal_value)
-        wait_value = clear_queue->next_signal_value - 1;
+    if (*wait_value == clear_queue->next_signal_value)
+        *wait_value = clear_queue->next_signal_value - 1;
 
     pthread_mutex_unlock(&clear_queue->mutex);
 
     /* If this allocation was suballocated from a chunk, we will wait
      * on the semaphore when the parent chunk itself gets destroyed. */
-    if (allocation->chunk)
+    return !!allocation->chunk;
+}
+
+static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+{
+    uint64_t wait_value;
+
+    if (vkd3d_memory_allocator_poll_allocation(allocator, device, allocation, &wait_value))
         return;
 
     /* Otherwise, we actually have to wait for the GPU. */
@@ -1115,9 +1509,152 @@ static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator
     vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, UINT64_MAX);
 }
 
+static bool vkd3d_memory_allocator_defer_free(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation, struct vkd3d_memory_chunk *chunk, uint64_t wait_value)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    struct vkd3d_memory_deferred_free *entry;
+    bool deferred = false;
+
+    /* The VA map tracks resources by pointer, and the caller's copy of
+     * the allocation will be gone by the time the worker frees it. */
+    if (!chunk && (allocation->flags & VKD3D_ALLOCATION_FLAG_GPU_ADDRESS) && allocation->resource.va)
+        vkd3d_va_map_remove(&allocator->va_map, &allocation->resource);
+
+    pthread_mutex_lock(&clear_queue->mutex);
+
+    if (clear_queue->worker_running && vkd3d_array_reserve((void**)&clear_queue->deferred_frees,
+            &clear_queue->deferred_frees_size, clear_queue->deferred_frees_count + 1,
+            sizeof(*clear_queue->deferred_frees)))
+    {
+        entry = &clear_queue->deferred_frees[clear_queue->deferred_frees_count++];
+        entry->wait_value = wait_value;
+        entry->chunk = chunk;
+        entry->allocation = *allocation;
+
+        pthread_cond_signal(&clear_queue->cond);
+        deferred = true;
+    }
+
+    pthread_mutex_unlock(&clear_queue->mutex);
+    return deferred;
+}
+
+static void *vkd3d_memory_clear_worker_main(void *userdata)
+{
+    struct vkd3d_memory_allocator *allocator = userdata;
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    struct d3d12_device *device = clear_queue->device;
+    struct vkd3d_memory_deferred_free *entries;
+    size_t entries_size, entries_count, i;
+    uint64_t wait_value;
+
+    vkd3d_set_thread_name("vkd3d_clear");
+
+    pthread_mutex_lock(&clear_queue->mutex);
+
+    for (;;)
+    {
+        if (clear_queue->num_bytes_pending >= VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES)
+            vkd3d_memory_allocator_flush_clears_locked(allocator, device);
+
+        if (clear_queue->deferred_frees_count)
+        {
+            /* Take ownership of all pending entries. Their clears have all been
+             * submitted already, so waiting for the last one is not much slower
+             * than releasing them one by one. */
+            entries = clear_queue->deferred_frees;
+            entries_size = clear_queue->deferred_frees_size;
+            entries_count = clear_queue->deferred_frees_count;
+
+            clear_queue->deferred_frees = NULL;
+            clear_queue->deferred_frees_size = 0;
+            clear_queue->deferred_frees_count = 0;
+
+            pthread_mutex_unlock(&clear_queue->mutex);
+
+            for (i = 0, wait_value = 0; i < entries_count; i++)
+                wait_value = max(wait_value, entries[i].wait_value);
+
+            vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, UINT64_MAX);
+
+            for (i = 0; i < entries_count; i++)
+            {
+                if (entries[i].chunk)
+                    vkd3d_memory_chunk_free(entries[i].chunk, device, allocator);
+                else
+                    vkd3d_memory_allocation_free(&entries[i].allocation, device, allocator);
+            }
+
+            pthread_mutex_lock(&clear_queue->mutex);
+
+            /* Hand the array back to avoid reallocating it every time */
+            if (!clear_queue->deferred_frees)
+            {
+                clear_queue->deferred_frees = entries;
+                clear_queue->deferred_frees_size = entries_size;
+            }
+            else
+                vkd3d_free(entries);
+
+            continue;
+        }
+
+        if (clear_queue->should_exit)
+            break;
+
+        pthread_cond_wait(&clear_queue->cond, &clear_queue->mutex);
+    }
+
+    pthread_mutex_unlock(&clear_queue->mutex);
+    return NULL;
+}
+
+static HRESULT vkd3d_memory_allocator_start_clear_worker(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    HRESULT hr;
+
+    clear_queue->device = device;
+    clear_queue->should_exit = false;
+    clear_queue->worker_running = true;
+
+    if (FAILED(hr = vkd3d_create_thread(device->vkd3d_instance,
+            vkd3d_memory_clear_worker_main, allocator, &clear_queue->worker_thread)))
+    {
+        ERR("Failed to create clear worker, hr %#x.\n", hr);
+        clear_queue->worker_running = false;
+    }
+
+    return hr;
+}
+
+static void vkd3d_memory_allocator_stop_clear_worker(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+
+    if (!clear_queue->worker_running)
+        return;
+
+    /* The worker releases all deferred frees before it exits */
+    pthread_mutex_lock(&clear_queue->mutex);
+    clear_queue->should_exit = true;
+    pthread_cond_signal(&clear_queue->cond);
+    pthread_mutex_unlock(&clear_queue->mutex);
+
+    vkd3d_join_thread(device->vkd3d_instance, &clear_queue->worker_thread);
+
+    pthread_mutex_lock(&clear_queue->mutex);
+    clear_queue->worker_running = false;
+    pthread_mutex_unlock(&clear_queue->mutex);
+}
+
 static HRESULT vkd3d_memory_allocator_add_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device,
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags, uint32_t type_mask, struct vkd3d_memory_chunk **chunk)
 {
+    struct vkd3d_memory_chunk_bucket *bucket;
     struct vkd3d_allocate_memory_info alloc_info;
     struct vkd3d_memory_chunk *object;
     HRESULT hr;
@@ -1132,84 +1669,355 @@ static HRESULT vkd3d_memory_allocator_add_chunk(struct vkd3d_memory_allocator *a
     if (!(heap_flags & D3D12_HEAP_FLAG_DENY_BUFFERS))
         alloc_info.flags |= VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER;
 
-    if (!vkd3d_array_reserve((void**)&allocator->chunks, &allocator->chunks_size,
-            allocator->chunks_count + 1, sizeof(*allocator->chunks)))
+    if (FAILED(hr = vkd3d_memory_chunk_create(device, allocator, &alloc_info, &object)))
+        return hr;
+
+    /* Clear the entire chunk once up front, since Vulkan does not guarantee
+     * zeroed memory. Suballocations can then skip clearing pages that have
+     * never been used. Host-visible chunks are cleared on the CPU instead. */
+    if (!object->allocation.cpu_address)
+        vkd3d_memory_allocator_clear_allocation(allocator, device, &object->allocation);
+
+    /* The memory type is only known once the chunk is allocated */
+    if (!(bucket = vkd3d_memory_allocator_get_chunk_bucket(allocator, object)) ||
+            !vkd3d_array_reserve((void**)&bucket->chunks, &bucket->chunks_size,
+                    bucket->chunks_count + 1, sizeof(*bucket->chunks)))
     {
         ERR("Failed to allocate space for new chunk.\n");
+        vkd3d_memory_chunk_destroy(object, device, allocator);
         return E_OUTOFMEMORY;
     }
 
-    if (FAILED(hr = vkd3d_memory_chunk_create(device, allocator, &alloc_info, &object)))
-        return hr;
-
-    allocator->chunks[allocator->chunks_count++] = *chunk = object;
+    bucket->chunks[bucket->chunks_count++] = *chunk = object;
     return S_OK;
 }
 
-static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory_allocator *allocator,
-        struct d3d12_device *device, const VkMemoryRequirements *memory_requirements, uint32_t type_mask,
+static D3D12_HEAP_FLAGS vkd3d_memory_chunk_get_heap_flags(D3D12_HEAP_FLAGS heap_flags)
+{
+    /* Chunks are shared between allocations that differ only in these flags */
+    return heap_flags & ~(D3D12_HEAP_FLAG_CREATE_NOT_ZEROED | D3D12_HEAP_FLAG_CREATE_NOT_RESIDENT);
+}
+
+static HRESULT vkd3d_memory_allocator_try_suballocate_from_chunks(struct vkd3d_memory_allocator *allocator,
+        const VkMemoryRequirements *memory_requirements, uint32_t type_mask,
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
         struct vkd3d_memory_allocation *allocation)
 {
-    const D3D12_HEAP_FLAGS heap_flag_mask = ~(D3D12_HEAP_FLAG_CREATE_NOT_ZEROED | D3D12_HEAP_FLAG_CREATE_NOT_RESIDENT);
-    struct vkd3d_memory_chunk *chunk;
+    struct vkd3d_memory_chunk_bucket *bucket;
     HRESULT hr;
-    size_t i;
-
-    type_mask &= device->memory_info.global_mask;
-    type_mask &= memory_requirements->memoryTypeBits;
+    size_t i, j;
 
-    for (i = 0; i < allocator->chunks_count; i++)
+    for (i = 0; i < allocator->chunk_buckets_count; i++)
     {
-        chunk = allocator->chunks[i];
+        bucket = &allocator->chunk_buckets[i];
 
         /* Match flags since otherwise the backing buffer
          * may not support our required usage flags */
-        if (chunk->allocation.heap_type != heap_properties->Type ||
-                chunk->allocation.heap_flags != (heap_flags & heap_flag_mask))
+        if (bucket->heap_type != heap_properties->Type ||
+                bucket->heap_flags != heap_flags)
             continue;
 
         /* Filter out unsupported memory types */
-        if (!(type_mask & (1u << chunk->allocation.vk_memory_type)))
+        if (!(type_mask & (1u << bucket->vk_memory_type)))
             continue;
 
-        if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
-            return hr;
+        for (j = 0; j < bucket->chunks_count; j++)
+        {
+            if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(bucket->chunks[j], memory_requirements, allocation)))
+                return hr;
+        }
     }
 
+    return E_OUTOFMEMORY;
+}
+
+static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const VkMemoryRequirements *memory_requirements, uint32_t type_mask,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_chunk *chunk;
+    HRESULT hr;
+
+    type_mask &= device->memory_info.global_mask;
+    type_mask &= memory_requirements->memoryTypeBits;
+    heap_flags = vkd3d_memory_chunk_get_heap_flags(heap_flags);
+
+    if (SUCCEEDED(hr = vkd3d_memory_allocator_try_suballocate_from_chunks(allocator,
+            memory_requirements, type_mask, heap_properties, heap_flags, allocation)))
+        return hr;
+
+    /* Ranges cached in magazines may be all that keeps an existing chunk
+     * from satisfying the request, so return them before allocating more */
+    if (vkd3d_memory_allocator_drain_magazines_locked(allocator, device) &&
+            SUCCEEDED(hr = vkd3d_memory_allocator_try_suballocate_from_chunks(allocator,
+                    memory_requirements, type_mask, heap_properties, heap_flags, allocation)))
+        return hr;
+
     /* Try allocating a new chunk on one of the supported memory type
      * before the caller falls back to potentially slower memory */
     if (FAILED(hr = vkd3d_memory_allocator_add_chunk(allocator, device, heap_properties,
-            heap_flags & heap_flag_mask, memory_requirements->memoryTypeBits, &chunk)))
+            heap_flags, memory_requirements->memoryTypeBits, &chunk)))
         return hr;
 
     return vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation);
 }
 
+static void vkd3d_memory_allocator_free_range_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+{
+    vkd3d_memory_chunk_free_range(allocation->chunk, allocation);
+
+    if (vkd3d_memory_chunk_is_free(allocation->chunk))
+        vkd3d_memory_allocator_remove_chunk(allocator, device, allocation->chunk);
+}
+
+static struct vkd3d_memory_magazine_shard *vkd3d_memory_allocator_get_magazine_shard(struct vkd3d_memory_allocator *allocator)
+{
+    return &allocator->magazine_shards[vkd3d_get_current_thread_id() % VKD3D_MEMORY_MAGAZINE_SHARD_COUNT];
+}
+
+static bool vkd3d_memory_magazine_shard_pop(struct vkd3d_memory_magazine_shard *shard,
+        D3D12_HEAP_TYPE heap_type, D3D12_HEAP_FLAGS heap_flags, VkDeviceSize size, uint32_t type_mask,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_magazine *magazine;
+    size_t i;
+
+    spinlock_acquire(&shard->lock);
+
+    for (i = 0; i < shard->magazines_count; i++)
+    {
+        magazine = &shard->magazines[i];
+
+        if (magazine->allocation_count && magazine->size == size &&
+                magazine->heap_type == heap_type && magazine->heap_flags == heap_flags &&
+                (type_mask & (1u << magazine->vk_memory_type)))
+        {
+            *allocation = magazine->allocations[--magazine->allocation_count];
+            shard->cached_bytes -= size;
+            magazine->used = true;
+            spinlock_release(&shard->lock);
+            return true;
+        }
+    }
+
+    spinlock_release(&shard->lock);
+    return false;
+}
+
+static bool vkd3d_memory_magazine_shard_push(struct vkd3d_memory_magazine_shard *shard,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    VkDeviceSize size = allocation->resource.size;
+    struct vkd3d_memory_magazine *magazine = NULL;
+    size_t i;
+
+    spinlock_acquire(&shard->lock);
+
+    if (shard->cached_bytes + size > VKD3D_MEMORY_MAGAZINE_SHARD_MAX_BYTES)
+        goto fail;
+
+    for (i = 0; i < shard->magazines_count; i++)
+    {
+        if (shard->magazines[i].size == size &&
+                shard->magazines[i].heap_type == allocation->heap_type &&
+                shard->magazines[i].heap_flags == allocation->heap_flags &&
+                shard->magazines[i].vk_memory_type == allocation->vk_memory_type)
+        {
+            magazine = &shard->magazines[i];
+            break;
+        }
+    }
+
+    if (!magazine)
+    {
+        if (!vkd3d_array_reserve((void**)&shard->magazines, &shard->magazines_size,
+                shard->magazines_count + 1, sizeof(*shard->magazines)))
+            goto fail;
+
+        magazine = &shard->magazines[shard->magazines_count++];
+        magazine->heap_type = allocation->heap_type;
+        magazine->heap_flags = allocation->heap_flags;
+        magazine->vk_memory_type = allocation->vk_memory_type;
+        magazine->size = size;
+        magazine->allocation_count = 0;
+    }
+
+    if (magazine->allocation_count == VKD3D_MEMORY_MAGAZINE_SIZE)
+        goto fail;
+
+    magazine->allocations[magazine->allocation_count++] = *allocation;
+    shard->cached_bytes += size;
+    magazine->used = true;
+    spinlock_release(&shard->lock);
+    return true;
+
+fail:
+    spinlock_release(&shard->lock);
+    return false;
+}
+
+static bool vkd3d_memory_allocator_flush_magazine_shard_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, struct vkd3d_memory_magazine_shard *shard, bool idle_only)
+{
+    struct vkd3d_memory_allocation allocations[VKD3D_MEMORY_MAGAZINE_SIZE];
+    struct vkd3d_memory_magazine *magazine;
+    uint32_t count, j;
+    bool flushed;
+    size_t i;
+
+    flushed = false;
+
+    /* Take the spinlock per magazine since the magazine array can be
+     * resized by other threads, and freeing ranges may destroy chunks */
+    for (i = 0; ; i++)
+    {
+        spinlock_acquire(&shard->lock);
+
+        if (i >= shard->magazines_count)
+        {
+            spinlock_release(&shard->lock);
+            break;
+        }
+
+        magazine = &shard->magazines[i];
+        count = 0;
+
+        if (!idle_only || !magazine->used)
+        {
+            count = magazine->allocation_count;
+            memcpy(allocations, magazine->allocations, count * sizeof(*allocations));
+            shard->cached_bytes -= count * magazine->size;
+            magazine->allocation_count = 0;
+        }
+
+        magazine->used = false;
+        spinlock_release(&shard->lock);
+
+        for (j = 0; j < count; j++)
+            vkd3d_memory_allocator_free_range_locked(allocator, device, &allocations[j]);
+
+        flushed |= count != 0;
+    }
+
+    return flushed;
+}
+
+static bool vkd3d_memory_allocator_drain_magazines_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
+{
+    bool drained = false;
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_MEMORY_MAGAZINE_SHARD_COUNT; i++)
+    {
+        drained |= vkd3d_memory_allocator_flush_magazine_shard_locked(allocator,
+                device, &allocator->magazine_shards[i], false);
+    }
+
+    return drained;
+}
+
+static void vkd3d_memory_allocator_trim_magazines_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
+{
+    unsigned int i;
+
+    if (++allocator->magazine_trim_counter < VKD3D_MEMORY_MAGAZINE_TRIM_INTERVAL)
+        return;
+
+    allocator->magazine_trim_counter = 0;
+
+    /* Return ranges from magazines which have not been used since the last trim */
+    for (i = 0; i < VKD3D_MEMORY_MAGAZINE_SHARD_COUNT; i++)
+    {
+        vkd3d_memory_allocator_flush_magazine_shard_locked(allocator,
+                device, &allocator->magazine_shards[i], true);
+    }
+}
+
+static bool vkd3d_memory_allocator_cache_allocation(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_chunk *chunk = allocation->chunk;
+    struct vkd3d_memory_allocation cached;
+
+    /* Only keep ranges that satisfy any alignment we hand out from magazines */
+    if ((allocation->resource.size | allocation->offset) & (VKD3D_MEMORY_MAGAZINE_GRANULARITY - 1))
+        return false;
+
+    /* Rebuild the allocation from the chunk since the caller may have modified its copy */
+    vkd3d_memory_allocation_slice(&cached, &chunk->allocation,
+            allocation->offset - chunk->allocation.offset, allocation->resource.size);
+    cached.chunk = chunk;
+    cached.chunk_block = allocation->chunk_block;
+
+    return vkd3d_memory_magazine_shard_push(vkd3d_memory_allocator_get_magazine_shard(allocator), &cached);
+}
+
 void vkd3d_free_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
         const struct vkd3d_memory_allocation *allocation)
 {
-    if (allocation->clear_semaphore_value)
-        vkd3d_memory_allocator_wait_allocation(allocator, device, allocation);
+    uint64_t wait_value;
+
+    /* Only dedicated allocations can fail the poll. Rather than waiting for the
+     * GPU, let the clear worker free the memory once its clear has completed. */
+    if (allocation->clear_semaphore_value &&
+            !vkd3d_memory_allocator_poll_allocation(allocator, device, allocation, &wait_value))
+    {
+        if (vkd3d_memory_allocator_defer_free(allocator, allocation, NULL, wait_value))
+            return;
+
+        vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, UINT64_MAX);
+    }
 
     if (allocation->chunk)
     {
-        pthread_mutex_lock(&allocator->mutex);
-        vkd3d_memory_chunk_free_range(allocation->chunk, allocation);
+        if (vkd3d_memory_allocator_cache_allocation(allocator, allocation))
+            return;
 
-        if (vkd3d_memory_chunk_is_free(allocation->chunk))
-            vkd3d_memory_allocator_remove_chunk(allocator, device, allocation->chunk);
+        pthread_mutex_lock(&allocator->mutex);
+        vkd3d_memory_allocator_free_range_locked(allocator, device, allocation);
+        vkd3d_memory_allocator_trim_magazines_locked(allocator, device);
         pthread_mutex_unlock(&allocator->mutex);
     }
     else
         vkd3d_memory_allocation_free(allocation, device, allocator);
 }
 
+static void vkd3d_memory_allocator_refill_magazine_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, struct vkd3d_memory_magazine_shard *shard,
+        const VkMemoryRequirements *memory_requirements, const struct vkd3d_memory_allocation *allocation)
+{
+    VkMemoryRequirements refill_requirements = *memory_requirements;
+    struct vkd3d_memory_allocation refill;
+    unsigned int i;
+
+    /* Only carve from the chunk we just allocated from so that refilling
+     * never allocates new device memory, and align ranges so that they
+     * can be handed out for any eligible request later on. */
+    refill_requirements.alignment = VKD3D_MEMORY_MAGAZINE_GRANULARITY;
+
+    for (i = 0; i < VKD3D_MEMORY_MAGAZINE_REFILL_COUNT; i++)
+    {
+        if (FAILED(vkd3d_memory_chunk_allocate_range(allocation->chunk, &refill_requirements, &refill)))
+            break;
+
+        if (!vkd3d_memory_magazine_shard_push(shard, &refill))
+        {
+            vkd3d_memory_allocator_free_range_locked(allocator, device, &refill);
+            break;
+        }
+    }
+}
+
 static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
         const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_allocation *allocation)
 {
     const VkMemoryPropertyFlags optional_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     VkMemoryRequirements memory_requirements = info->memory_requirements;
+    struct vkd3d_memory_magazine_shard *shard = NULL;
     uint32_t required_mask, optional_mask;
     VkMemoryPropertyFlags type_flags;
     HRESULT hr;
@@ -1221,12 +2029,33 @@ static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3
     required_mask = vkd3d_find_memory_types_with_flags(device, type_flags & ~optional_flags);
     optional_mask = vkd3d_find_memory_types_with_flags(device, type_flags);
 
+    if (!(memory_requirements.size & (VKD3D_MEMORY_MAGAZINE_GRANULARITY - 1)) &&
+            memory_requirements.alignment <= VKD3D_MEMORY_MAGAZINE_GRANULARITY)
+    {
+        shard = vkd3d_memory_allocator_get_magazine_shard(allocator);
+
+        if (vkd3d_memory_magazine_shard_pop(shard, info->heap_properties.Type,
+                vkd3d_memory_chunk_get_heap_flags(info->heap_flags), memory_requirements.size,
+                optional_mask & memory_requirements.memoryTypeBits & device->memory_info.global_mask,
+                allocation))
+            return S_OK;
+    }
+
     pthread_mutex_lock(&allocator->mutex);
 
+    vkd3d_memory_allocator_trim_magazines_locked(allocator, device);
+
     hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
             &memory_requirements, optional_mask, &info->heap_properties,
             info->heap_flags, allocation);
 
+    /* Refill the magazine while we hold the lock anyway */
+    if (SUCCEEDED(hr) && shard)
+    {
+        vkd3d_memory_allocator_refill_magazine_locked(allocator, device,
+                shard, &memory_requirements, allocation);
+    }
+
     if (FAILED(hr) && (required_mask & ~optional_mask))
     {
         hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
@@ -1241,19 +2070,30 @@ static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3
 HRESULT vkd3d_allocate_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
         const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_allocation *allocation)
 {
+    bool drained;
     HRESULT hr;
 
     if (!info->pNext && !info->host_ptr && info->memory_requirements.size < VKD3D_VA_BLOCK_SIZE &&
             !(info->heap_flags & (D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_ALLOW_WRITE_WATCH)))
         hr = vkd3d_suballocate_memory(device, allocator, info, allocation);
-    else
-        hr = vkd3d_memory_allocation_init(allocation, device, allocator, info);
+    else if (FAILED(hr = vkd3d_memory_allocation_init(allocation, device, allocator, info)))
+    {
+        /* Cached ranges may keep otherwise unused chunks alive, release them and retry */
+        pthread_mutex_lock(&allocator->mutex);
+        drained = vkd3d_memory_allocator_drain_magazines_locked(allocator, device);
+        pthread_mutex_unlock(&allocator->mutex);
+
+        if (drained)
+            hr = vkd3d_memory_allocation_init(allocation, device, allocator, info);
+    }
 
     if (FAILED(hr))
         return hr;
 
     if (!(info->heap_flags & D3D12_HEAP_FLAG_CREATE_NOT_ZEROED))
         vkd3d_memory_allocator_clear_allocation(allocator, device, allocation);
+    else if (allocation->chunk && !allocation->cpu_address)
+        vkd3d_memory_allocator_mark_allocation_dirty(allocator, allocation);
 
     return hr;
 }
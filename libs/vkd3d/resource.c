@@ -22,10 +22,14 @@
 #include <float.h>
 
 #include "vkd3d_private.h"
-#include "vkd3d_rw_spinlock.h"
 #include "vkd3d_descriptor_debug.h"
 #include "hashmap.h"
 
+#if defined(__SSE2__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define VKD3D_DESC_COPY_SSE2
+#endif
+
 #define VKD3D_NULL_SRV_FORMAT DXGI_FORMAT_R8G8B8A8_UNORM
 #define VKD3D_NULL_UAV_FORMAT DXGI_FORMAT_R32_UINT
 
@@ -573,16 +577,82 @@ static HRESULT vkd3d_create_image(struct d3d12_device *device,
     return hresult_from_vk_result(vr);
 }
 
+struct vkd3d_memory_requirements_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_memory_requirements_key key;
+    VkMemoryRequirements requirements;
+};
+
+STATIC_ASSERT(sizeof(struct vkd3d_memory_requirements_key) == 40);
+
+static uint32_t vkd3d_memory_requirements_entry_hash(const void *key)
+{
+    const struct vkd3d_memory_requirements_key *k = key;
+    uint32_t hash;
+
+    hash = hash_uint64(k->width);
+    hash = hash_combine(hash, k->dimension);
+    hash = hash_combine(hash, k->format);
+    hash = hash_combine(hash, k->height);
+    hash = hash_combine(hash, k->sample_count);
+    hash = hash_combine(hash, k->sample_quality);
+    hash = hash_combine(hash, k->layout);
+    hash = hash_combine(hash, k->flags);
+    hash = hash_combine(hash, k->depth_or_array_size | (k->mip_levels << 16));
+    return hash;
+}
+
+static bool vkd3d_memory_requirements_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_memory_requirements_entry *e = (const struct vkd3d_memory_requirements_entry *)entry;
+
+    return !memcmp(&e->key, key, sizeof(e->key));
+}
+
+void vkd3d_memory_requirements_cache_init(struct vkd3d_memory_requirements_cache *cache)
+{
+    spinlock_init(&cache->spinlock);
+    concurrent_hash_map_init(&cache->map, vkd3d_memory_requirements_entry_hash,
+            vkd3d_memory_requirements_entry_compare, sizeof(struct vkd3d_memory_requirements_entry));
+}
+
+void vkd3d_memory_requirements_cache_cleanup(struct vkd3d_memory_requirements_cache *cache)
+{
+    concurrent_hash_map_clear(&cache->map);
+}
+
+static void vkd3d_memory_requirements_key_init(struct vkd3d_memory_requirements_key *key,
+        const D3D12_RESOURCE_DESC *desc)
+{
+    /* Alignment is left out on purpose, it only affects how we pad
+     * the reported size and not the image we would create. */
+    memset(key, 0, sizeof(*key));
+    key->width = desc->Width;
+    key->dimension = desc->Dimension;
+    key->format = desc->Format;
+    key->height = desc->Height;
+    key->sample_count = desc->SampleDesc.Count;
+    key->sample_quality = desc->SampleDesc.Quality;
+    key->layout = desc->Layout;
+    key->flags = desc->Flags;
+    key->depth_or_array_size = desc->DepthOrArraySize;
+    key->mip_levels = desc->MipLevels;
+}
+
 HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
 {
     static const D3D12_HEAP_PROPERTIES heap_properties = {D3D12_HEAP_TYPE_DEFAULT};
+    struct vkd3d_memory_requirements_cache *cache = &device->memory_requirements_cache;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_memory_requirements_entry entry, *e;
+    struct vkd3d_memory_requirements_key key;
     D3D12_RESOURCE_DESC validated_desc;
     VkMemoryRequirements requirements;
     VkDeviceSize target_alignment;
     VkImage vk_image;
-    HRESULT hr;
+    HRESULT hr = S_OK;
 
     assert(desc->Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
     assert(d3d12_resource_validate_desc(desc, device) == S_OK);
@@ -594,12 +664,31 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         desc = &validated_desc;
     }
 
-    /* XXX: We have to create an image to get its memory requirements. */
-    if (FAILED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
-        return hr;
+    vkd3d_memory_requirements_key_init(&key, desc);
 
-    VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
-    VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
+    if ((e = (struct vkd3d_memory_requirements_entry *)concurrent_hash_map_find(&cache->map, &key)))
+    {
+        requirements = e->requirements;
+    }
+    else
+    {
+        /* XXX: We have to create an image to get its memory requirements. */
+        if (FAILED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
+            return hr;
+
+        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
+        VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
+
+        /* If another thread inserted the same key in the meantime, the
+         * requirements are identical, so we can ignore the result. A failed
+         * insert only means that we will query the requirements again. */
+        entry.key = key;
+        entry.requirements = requirements;
+
+        spinlock_acquire(&cache->spinlock);
+        concurrent_hash_map_insert(&cache->map, &key, &entry.entry);
+        spinlock_release(&cache->spinlock);
+    }
 
     allocation_info->SizeInBytes = requirements.size;
     allocation_info->Alignment = requirements.alignment;
@@ -743,8 +832,8 @@ static bool vkd3d_view_entry_compare(const void *key, const struct hash_map_entr
 
 HRESULT vkd3d_view_map_init(struct vkd3d_view_map *view_map)
 {
-    view_map->spinlock = 0;
-    hash_map_init(&view_map->map, &vkd3d_view_entry_hash, &vkd3d_view_entry_compare, sizeof(struct vkd3d_view_entry));
+    spinlock_init(&view_map->spinlock);
+    concurrent_hash_map_init(&view_map->map, &vkd3d_view_entry_hash, &vkd3d_view_entry_compare, sizeof(struct vkd3d_view_entry));
     return S_OK;
 }
 
@@ -752,17 +841,18 @@ static void vkd3d_view_destroy(struct vkd3d_view *view, struct d3d12_device *dev
 
 void vkd3d_view_map_destroy(struct vkd3d_view_map *view_map, struct d3d12_device *device)
 {
+    const struct concurrent_hash_map_table *table = view_map->map.table;
     uint32_t i;
 
-    for (i = 0; i < view_map->map.entry_count; i++)
+    for (i = 0; table && i < table->entry_count; i++)
     {
-        struct vkd3d_view_entry *e = (struct vkd3d_view_entry *)hash_map_get_entry(&view_map->map, i);
+        struct vkd3d_view_entry *e = (struct vkd3d_view_entry *)concurrent_hash_map_table_get_entry(&view_map->map, table, i);
 
         if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
             vkd3d_view_destroy(e->view, device);
     }
 
-    hash_map_clear(&view_map->map);
+    concurrent_hash_map_clear(&view_map->map);
 }
 
 static struct vkd3d_view *vkd3d_view_create(enum vkd3d_view_type type);
@@ -779,17 +869,9 @@ struct vkd3d_view *vkd3d_view_map_create_view(struct vkd3d_view_map *view_map,
     bool success;
 
     /* In the steady state, we will be reading existing entries from a view map.
-     * Prefer read-write spinlocks here to reduce contention as much as possible. */
-    rw_spinlock_acquire_read(&view_map->spinlock);
-
-    if ((e = (struct vkd3d_view_entry *)hash_map_find(&view_map->map, key)))
-    {
-        view = e->view;
-        rw_spinlock_release_read(&view_map->spinlock);
-        return view;
-    }
-
-    rw_spinlock_release_read(&view_map->spinlock);
+     * Lookups do not take the lock, so hits do not write to shared memory at all. */
+    if ((e = (struct vkd3d_view_entry *)concurrent_hash_map_find(&view_map->map, key)))
+        return e->view;
 
     switch (key->view_type)
     {
@@ -825,29 +907,34 @@ struct vkd3d_view *vkd3d_view_map_create_view(struct vkd3d_view_map *view_map,
     entry.key = *key;
     entry.view = view;
 
-    rw_spinlock_acquire_write(&view_map->spinlock);
+    spinlock_acquire(&view_map->spinlock);
 
-    if (!(e = (struct vkd3d_view_entry *)hash_map_insert(&view_map->map, key, &entry.entry)))
+    if (!(e = (struct vkd3d_view_entry *)concurrent_hash_map_insert(&view_map->map, key, &entry.entry)))
+    {
         ERR("Failed to insert view into hash map.\n");
+        spinlock_release(&view_map->spinlock);
+        vkd3d_view_decref(view, device);
+        return NULL;
+    }
 
     if (e->view != view)
     {
         /* We yielded on the insert because another thread came in-between, and allocated a new hash map entry.
-         * This can happen between releasing reader lock, and acquiring writer lock. */
+         * This can happen between the lock-free lookup and acquiring the lock. */
         redundant_view = view;
         view = e->view;
-        rw_spinlock_release_write(&view_map->spinlock);
+        spinlock_release(&view_map->spinlock);
         vkd3d_view_decref(redundant_view, device);
     }
     else
     {
         /* If we start emitting too many typed SRVs, we will eventually crash on NV, since
          * VkBufferView objects appear to consume GPU resources. */
-        if ((view_map->map.used_count % 1024) == 0)
-            ERR("Intense view map pressure! Got %u views in hash map %p.\n", view_map->map.used_count, &view_map->map);
+        if ((view_map->map.table->used_count % 1024) == 0)
+            ERR("Intense view map pressure! Got %u views in hash map %p.\n", view_map->map.table->used_count, &view_map->map);
 
         view = e->view;
-        rw_spinlock_release_write(&view_map->spinlock);
+        spinlock_release(&view_map->spinlock);
     }
 
     return view;
@@ -2704,6 +2791,10 @@ static struct vkd3d_view *vkd3d_view_create(enum vkd3d_view_type type)
         view->refcount = 1;
         view->type = type;
         view->cookie = vkd3d_allocate_cookie();
+        view->framebuffer_refs = 0;
+        view->framebuffers = NULL;
+        view->framebuffers_size = 0;
+        view->framebuffers_count = 0;
     }
     return view;
 }
@@ -2727,6 +2818,9 @@ static void vkd3d_view_destroy(struct vkd3d_view *view, struct d3d12_device *dev
             VK_CALL(vkDestroyBufferView(device->vk_device, view->vk_buffer_view, NULL));
             break;
         case VKD3D_VIEW_TYPE_IMAGE:
+            if (vkd3d_atomic_uint32_load_explicit(&view->framebuffer_refs, vkd3d_memory_order_acquire))
+                vkd3d_framebuffer_cache_evict_view(&device->framebuffer_cache, device, view);
+            vkd3d_free(view->framebuffers);
             VK_CALL(vkDestroyImageView(device->vk_device, view->vk_image_view, NULL));
             break;
         case VKD3D_VIEW_TYPE_SAMPLER:
@@ -2748,39 +2842,104 @@ void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device)
         vkd3d_view_destroy(view, device);
 }
 
-static void d3d12_desc_copy_single(struct d3d12_desc *dst, struct d3d12_desc *src,
-        struct d3d12_device *device)
+void d3d12_desc_copy_batch_flush(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device)
 {
-    VkCopyDescriptorSet vk_copies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (batch->copy_count)
+    {
+        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, batch->copy_count, batch->vk_copies));
+        batch->copy_count = 0;
+    }
+}
+
+/* Only look at the last few copies, one descriptor emits at most one copy per set plus the aux buffer. */
+#define VKD3D_DESC_COPY_BATCH_MERGE_WINDOW (VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS + 1)
+
+static void d3d12_desc_copy_batch_add(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device,
+        VkDescriptorSet src_set, VkDescriptorSet dst_set, uint32_t binding,
+        uint32_t src_array_element, uint32_t dst_array_element, uint32_t count)
+{
+    VkCopyDescriptorSet *vk_copy;
+    uint32_t i, window;
+
+    window = min(batch->copy_count, VKD3D_DESC_COPY_BATCH_MERGE_WINDOW);
+
+    for (i = 0; i < window; i++)
+    {
+        vk_copy = &batch->vk_copies[batch->copy_count - 1 - i];
+
+        if (vk_copy->dstBinding != binding)
+            continue;
+        if (vk_copy->srcSet != src_set && vk_copy->srcSet != dst_set &&
+                vk_copy->dstSet != src_set && vk_copy->dstSet != dst_set)
+            continue;
+
+        /* Copies are performed in order, so we can only extend the most recent copy
+         * which may alias with this one. Anything else would reorder the copies. */
+        if (vk_copy->srcSet == src_set && vk_copy->dstSet == dst_set &&
+                vk_copy->srcArrayElement + vk_copy->descriptorCount == src_array_element &&
+                vk_copy->dstArrayElement + vk_copy->descriptorCount == dst_array_element)
+        {
+            vk_copy->descriptorCount += count;
+            return;
+        }
+
+        break;
+    }
+
+    if (batch->copy_count == ARRAY_SIZE(batch->vk_copies))
+        d3d12_desc_copy_batch_flush(batch, device);
+
+    vk_copy = &batch->vk_copies[batch->copy_count++];
+    vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+    vk_copy->pNext = NULL;
+    vk_copy->srcSet = src_set;
+    vk_copy->srcBinding = binding;
+    vk_copy->srcArrayElement = src_array_element;
+    vk_copy->dstSet = dst_set;
+    vk_copy->dstBinding = binding;
+    vk_copy->dstArrayElement = dst_array_element;
+    vk_copy->descriptorCount = count;
+}
+
+static bool d3d12_desc_needs_update(const struct d3d12_desc *dst, const struct d3d12_desc *src)
+{
+    /* Only update the descriptor if something has changed */
+    if (src->metadata.cookie != dst->metadata.cookie)
+        return true;
+
+    /* We don't have a cookie for the UAV counter, so just force update if we have that.
+     * If flags differ, we also need to update. E.g. happens if UAV counter flag is turned off.
+     * We have no cookie for the UAV counter itself.
+     * Null descriptors share a cookie, so the set mask must match as well, otherwise
+     * e.g. a null SRV would be considered equal to a null UAV.
+     * Lastly, if we have plain VkBuffers, offset/range might differ. */
+    if ((src->metadata.flags & VKD3D_DESCRIPTOR_FLAG_RAW_VA_AUX_BUFFER) != 0 ||
+        (src->metadata.flags != dst->metadata.flags) ||
+        (src->metadata.set_info_mask != dst->metadata.set_info_mask))
+        return true;
+
+    if (src->metadata.flags & VKD3D_DESCRIPTOR_FLAG_OFFSET_RANGE)
+    {
+        return dst->info.buffer.offset != src->info.buffer.offset ||
+                dst->info.buffer.range != src->info.buffer.range;
+    }
+
+    return false;
+}
+
+static void d3d12_desc_copy_single(struct d3d12_desc *dst, struct d3d12_desc *src,
+        struct d3d12_desc_copy_batch *batch, struct d3d12_device *device)
+{
     struct vkd3d_descriptor_data metadata = src->metadata;
     struct vkd3d_descriptor_binding binding;
     uint32_t set_mask, set_info_index;
     const VkDescriptorSet *src_sets;
     const VkDescriptorSet *dst_sets;
-    VkCopyDescriptorSet *vk_copy;
-    uint32_t copy_count = 0;
     bool needs_update;
 
-    /* Only update the descriptor if something has changed */
-    if (!(needs_update = (metadata.cookie != dst->metadata.cookie)))
-    {
-        /* We don't have a cookie for the UAV counter, so just force update if we have that.
-         * If flags differ, we also need to update. E.g. happens if UAV counter flag is turned off.
-         * We have no cookie for the UAV counter itself.
-         * Lastly, if we have plain VkBuffers, offset/range might differ. */
-        if ((metadata.flags & VKD3D_DESCRIPTOR_FLAG_RAW_VA_AUX_BUFFER) != 0 ||
-            (metadata.flags != dst->metadata.flags))
-        {
-            needs_update = true;
-        }
-        else if (metadata.flags & VKD3D_DESCRIPTOR_FLAG_OFFSET_RANGE)
-        {
-            needs_update =
-                    dst->info.buffer.offset != src->info.buffer.offset ||
-                    dst->info.buffer.range != src->info.buffer.range;
-        }
-    }
+    needs_update = d3d12_desc_needs_update(dst, src);
 
     if (needs_update)
     {
@@ -2795,16 +2954,8 @@ static void d3d12_desc_copy_single(struct d3d12_desc *dst, struct d3d12_desc *sr
             set_info_index = vkd3d_bitmask_iter32(&set_mask);
             binding = vkd3d_bindless_state_binding_from_info_index(&device->bindless_state, set_info_index);
 
-            vk_copy = &vk_copies[copy_count++];
-            vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-            vk_copy->pNext = NULL;
-            vk_copy->srcSet = src_sets[binding.set];
-            vk_copy->srcBinding = binding.binding;
-            vk_copy->srcArrayElement = src->heap_offset;
-            vk_copy->dstSet = dst_sets[binding.set];
-            vk_copy->dstBinding = binding.binding;
-            vk_copy->dstArrayElement = dst->heap_offset;
-            vk_copy->descriptorCount = 1;
+            d3d12_desc_copy_batch_add(batch, device, src_sets[binding.set], dst_sets[binding.set],
+                    binding.binding, src->heap_offset, dst->heap_offset, 1);
         }
 
         if (metadata.flags & VKD3D_DESCRIPTOR_FLAG_RAW_VA_AUX_BUFFER)
@@ -2820,21 +2971,10 @@ static void d3d12_desc_copy_single(struct d3d12_desc *dst, struct d3d12_desc *sr
                 binding = vkd3d_bindless_state_find_set(
                         &device->bindless_state, VKD3D_BINDLESS_SET_UAV | VKD3D_BINDLESS_SET_AUX_BUFFER);
 
-                vk_copy = &vk_copies[copy_count++];
-                vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-                vk_copy->pNext = NULL;
-                vk_copy->srcSet = src->heap->vk_descriptor_sets[binding.set];
-                vk_copy->srcBinding = binding.binding;
-                vk_copy->srcArrayElement = src->heap_offset;
-                vk_copy->dstSet = dst->heap->vk_descriptor_sets[binding.set];
-                vk_copy->dstBinding = binding.binding;
-                vk_copy->dstArrayElement = dst->heap_offset;
-                vk_copy->descriptorCount = 1;
+                d3d12_desc_copy_batch_add(batch, device, src_sets[binding.set], dst_sets[binding.set],
+                        binding.binding, src->heap_offset, dst->heap_offset, 1);
             }
         }
-
-        if (copy_count)
-            VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, copy_count, vk_copies));
     }
 
     if (metadata.flags & VKD3D_DESCRIPTOR_FLAG_BUFFER_OFFSET)
@@ -2845,40 +2985,95 @@ static void d3d12_desc_copy_single(struct d3d12_desc *dst, struct d3d12_desc *sr
     }
 }
 
-void d3d12_desc_copy_range(struct d3d12_desc *dst, struct d3d12_desc *src,
-        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device)
+/* Shader visible heaps are rarely read back by the CPU after a large copy,
+ * so stream those copies past the cache. */
+#define VKD3D_DESC_COPY_STREAMING_THRESHOLD 256
+
+#ifdef VKD3D_DESC_COPY_SSE2
+/* The SSE2 path copies the metadata and info blocks as whole 16 byte lanes. */
+STATIC_ASSERT(offsetof(struct d3d12_desc, metadata) == 0);
+STATIC_ASSERT(offsetof(struct d3d12_desc, heap) == 16);
+STATIC_ASSERT(offsetof(struct d3d12_desc, heap_offset) == 24);
+STATIC_ASSERT(offsetof(struct d3d12_desc, info) == 32);
+#endif
+
+static void d3d12_desc_copy_payload(struct d3d12_desc *dst, const struct d3d12_desc *src, unsigned int count)
 {
-    VkCopyDescriptorSet vk_copies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct vkd3d_descriptor_binding binding;
-    VkCopyDescriptorSet *vk_copy;
-    uint32_t set_info_mask = 0;
-    uint32_t copy_count = 0;
-    uint32_t set_info_index;
+#ifdef VKD3D_DESC_COPY_SSE2
+    const struct d3d12_descriptor_heap *dst_heap = dst->heap;
+    uint32_t dst_heap_offset = dst->heap_offset;
+    const __m128i *src_lanes;
+    __m128i *dst_lanes;
+    unsigned int i;
+
+    if (count >= VKD3D_DESC_COPY_STREAMING_THRESHOLD &&
+            (dst_heap->desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE))
+    {
+        /* Non-temporal stores must cover entire cache lines to be efficient,
+         * so rebuild the heap lane rather than reading it back from dst. */
+        for (i = 0; i < count; i++)
+        {
+            src_lanes = (const __m128i *)&src[i];
+            dst_lanes = (__m128i *)&dst[i];
+            _mm_stream_si128(dst_lanes + 0, _mm_load_si128(src_lanes + 0));
+            _mm_stream_si128(dst_lanes + 1, _mm_set_epi64x(dst_heap_offset + i, (int64_t)(uintptr_t)dst_heap));
+            _mm_stream_si128(dst_lanes + 2, _mm_load_si128(src_lanes + 2));
+            _mm_stream_si128(dst_lanes + 3, _mm_load_si128(src_lanes + 3));
+        }
+
+        _mm_sfence();
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            src_lanes = (const __m128i *)&src[i];
+            dst_lanes = (__m128i *)&dst[i];
+            _mm_store_si128(dst_lanes + 0, _mm_load_si128(src_lanes + 0));
+            _mm_store_si128(dst_lanes + 2, _mm_load_si128(src_lanes + 2));
+            _mm_store_si128(dst_lanes + 3, _mm_load_si128(src_lanes + 3));
+        }
+    }
+#else
     unsigned int i;
 
     for (i = 0; i < count; i++)
     {
-        set_info_mask |= src[i].metadata.set_info_mask;
         dst[i].metadata = src[i].metadata;
         dst[i].info = src[i].info;
     }
+#endif
+}
+
+static void d3d12_desc_copy_range(struct d3d12_desc *dst, struct d3d12_desc *src,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
+        struct d3d12_desc_copy_batch *batch, struct d3d12_device *device)
+{
+    struct vkd3d_descriptor_binding binding;
+    uint32_t set_info_mask = 0;
+    uint32_t set_info_index;
+    bool needs_update;
+    unsigned int i;
+
+    /* Applications tend to copy the same descriptors over and over again.
+     * The scan stops at the first mismatch, so real copies only pay for a single check. */
+    for (i = 0, needs_update = false; i < count && !needs_update; i++)
+        needs_update = d3d12_desc_needs_update(&dst[i], &src[i]);
+
+    for (i = 0; needs_update && i < count; i++)
+        set_info_mask |= src[i].metadata.set_info_mask;
+
+    if (needs_update)
+        d3d12_desc_copy_payload(dst, src, count);
 
     while (set_info_mask)
     {
         set_info_index = vkd3d_bitmask_iter32(&set_info_mask);
         binding = vkd3d_bindless_state_binding_from_info_index(&device->bindless_state, set_info_index);
 
-        vk_copy = &vk_copies[copy_count++];
-        vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-        vk_copy->pNext = NULL;
-        vk_copy->srcSet = src->heap->vk_descriptor_sets[binding.set];
-        vk_copy->srcBinding = binding.binding;
-        vk_copy->srcArrayElement = src->heap_offset;
-        vk_copy->dstSet = dst->heap->vk_descriptor_sets[binding.set];
-        vk_copy->dstBinding = binding.binding;
-        vk_copy->dstArrayElement = dst->heap_offset;
-        vk_copy->descriptorCount = count;
+        d3d12_desc_copy_batch_add(batch, device,
+                src->heap->vk_descriptor_sets[binding.set], dst->heap->vk_descriptor_sets[binding.set],
+                binding.binding, src->heap_offset, dst->heap_offset, count);
     }
 
     if (heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
@@ -2889,20 +3084,13 @@ void d3d12_desc_copy_range(struct d3d12_desc *dst, struct d3d12_desc *src,
             VkDeviceAddress *dst_vas = dst->heap->raw_va_aux_buffer.host_ptr;
             memcpy(dst_vas + dst->heap_offset, src_vas + src->heap_offset, sizeof(*dst_vas) * count);
         }
-        else
+        else if (needs_update)
         {
             binding = vkd3d_bindless_state_find_set(&device->bindless_state, VKD3D_BINDLESS_SET_UAV | VKD3D_BINDLESS_SET_AUX_BUFFER);
 
-            vk_copy = &vk_copies[copy_count++];
-            vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-            vk_copy->pNext = NULL;
-            vk_copy->srcSet = src->heap->vk_descriptor_sets[binding.set];
-            vk_copy->srcBinding = binding.binding;
-            vk_copy->srcArrayElement = src->heap_offset;
-            vk_copy->dstSet = dst->heap->vk_descriptor_sets[binding.set];
-            vk_copy->dstBinding = binding.binding;
-            vk_copy->dstArrayElement = dst->heap_offset;
-            vk_copy->descriptorCount = count;
+            d3d12_desc_copy_batch_add(batch, device,
+                    src->heap->vk_descriptor_sets[binding.set], dst->heap->vk_descriptor_sets[binding.set],
+                    binding.binding, src->heap_offset, dst->heap_offset, count);
         }
 
         if (device->bindless_state.flags & (VKD3D_TYPED_OFFSET_BUFFER | VKD3D_SSBO_OFFSET_BUFFER))
@@ -2912,13 +3100,10 @@ void d3d12_desc_copy_range(struct d3d12_desc *dst, struct d3d12_desc *src,
             memcpy(dst_ranges + dst->heap_offset, src_ranges + src->heap_offset, sizeof(*dst_ranges) * count);
         }
     }
-
-    if (copy_count)
-        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, copy_count, vk_copies));
 }
 
-void d3d12_desc_copy(struct d3d12_desc *dst, struct d3d12_desc *src,
-        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device)
+void d3d12_desc_copy(struct d3d12_desc *dst, struct d3d12_desc *src, unsigned int count,
+        D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_desc_copy_batch *batch, struct d3d12_device *device)
 {
     unsigned int i;
 
@@ -2933,11 +3118,11 @@ void d3d12_desc_copy(struct d3d12_desc *dst, struct d3d12_desc *src,
 #endif
 
     if (device->bindless_state.flags & VKD3D_BINDLESS_MUTABLE_TYPE)
-        d3d12_desc_copy_range(dst, src, count, heap_type, device);
+        d3d12_desc_copy_range(dst, src, count, heap_type, batch, device);
     else
     {
         for (i = 0; i < count; i++)
-            d3d12_desc_copy_single(dst + i, src + i, device);
+            d3d12_desc_copy_single(dst + i, src + i, batch, device);
     }
 }
 
@@ -839,7 +839,8 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
     unsigned int i, j, k;
     HRESULT hr = S_OK;
 
-    if (info->push_descriptor_count || (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK))
+    if (info->push_descriptor_count || (root_signature->flags &
+            (VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK | VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER)))
     {
         if (!(vk_binding_info = vkd3d_malloc(sizeof(*vk_binding_info) * (info->push_descriptor_count + 1))))
             return E_OUTOFMEMORY;
@@ -971,6 +972,22 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
 
         context->vk_binding += 1;
     }
+    else if (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER)
+    {
+        /* This is the only binding in the set, so the layout is identical
+         * for all root signatures that use a root parameter buffer. */
+        vk_binding = &vk_binding_info[j++];
+        vk_binding->binding = context->vk_binding;
+        vk_binding->descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        vk_binding->descriptorCount = 1;
+        vk_binding->stageFlags = VK_SHADER_STAGE_ALL;
+        vk_binding->pImmutableSamplers = NULL;
+
+        root_signature->push_constant_ubo_binding.set = context->vk_set;
+        root_signature->push_constant_ubo_binding.binding = context->vk_binding;
+
+        context->vk_binding += 1;
+    }
 
     if (j)
     {
@@ -1187,6 +1204,15 @@ static HRESULT d3d12_root_signature_init_global(struct d3d12_root_signature *roo
         root_signature->flags |= VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK |
                 VKD3D_ROOT_SIGNATURE_USE_ROOT_DESCRIPTOR_SET;
     }
+    else if (!info.push_descriptor_count)
+    {
+        /* Without inline uniform blocks, all root parameters live in a single
+         * uniform buffer, so the descriptor set never changes and updates only
+         * need a new dynamic offset. Real root descriptors cannot be stored
+         * in the buffer, so root signatures using them are not supported. */
+        root_signature->flags |= VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER |
+                VKD3D_ROOT_SIGNATURE_USE_ROOT_DESCRIPTOR_SET;
+    }
     else
     {
         ERR("Root signature requires %d bytes of push constant space, but device only supports %d bytes.\n",
@@ -1214,7 +1240,8 @@ static HRESULT d3d12_root_signature_init_global(struct d3d12_root_signature *roo
     if (FAILED(hr = d3d12_root_signature_init_root_descriptor_tables(root_signature, desc, &info, &context)))
         return hr;
 
-    if (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK)
+    if (root_signature->flags & (VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK |
+            VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER))
         root_signature->push_constant_range.stageFlags = 0;
 
     /* If we need to use restricted entry_points in vkCmdPushConstants,
@@ -1334,7 +1361,8 @@ unsigned int d3d12_root_signature_get_shader_interface_flags(const struct d3d12_
 {
     unsigned int flags = 0;
 
-    if (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK)
+    if (root_signature->flags & (VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK |
+            VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER))
         flags |= VKD3D_SHADER_INTERFACE_PUSH_CONSTANTS_AS_UNIFORM_BUFFER;
 
     if (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_SSBO_OFFSET_BUFFER)
@@ -1354,12 +1382,35 @@ unsigned int d3d12_root_signature_get_shader_interface_flags(const struct d3d12_
 /* vkd3d_render_pass_cache */
 struct vkd3d_render_pass_entry
 {
+    struct hash_map_entry entry;
     struct vkd3d_render_pass_key key;
     VkRenderPass vk_render_pass;
 };
 
 STATIC_ASSERT(sizeof(struct vkd3d_render_pass_key) == 48);
 
+static uint32_t vkd3d_render_pass_entry_hash(const void *key)
+{
+    const struct vkd3d_render_pass_key *k = key;
+    uint32_t hash;
+    unsigned int i;
+
+    hash = hash_combine(k->attachment_count, k->flags);
+    hash = hash_combine(hash, k->sample_count);
+
+    for (i = 0; i < k->attachment_count; i++)
+        hash = hash_combine(hash, k->vk_formats[i]);
+
+    return hash;
+}
+
+static bool vkd3d_render_pass_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_render_pass_entry *e = (const struct vkd3d_render_pass_entry *)entry;
+
+    return !memcmp(&e->key, key, sizeof(e->key));
+}
+
 static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd3d_render_pass_key *key)
 {
     if (!(key->flags & VKD3D_RENDER_PASS_KEY_DEPTH_STENCIL_ENABLE))
@@ -1375,14 +1426,13 @@ static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd
         return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 }
 
-static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pass_cache *cache,
-        struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
+static HRESULT vkd3d_render_pass_cache_create_pass(struct d3d12_device *device,
+        const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
     VkAttachmentReference2KHR attachment_references[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
     VkAttachmentDescription2KHR attachments[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkFragmentShadingRateAttachmentInfoKHR vrs_attachment_info;
-    struct vkd3d_render_pass_entry *entry;
     unsigned int index, attachment_index;
     VkSubpassDependency2KHR dependencies[2];
     VkSubpassDescription2KHR sub_pass_desc;
@@ -1392,17 +1442,6 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     unsigned int rt_count;
     VkResult vr;
 
-    if (!vkd3d_array_reserve((void **)&cache->render_passes, &cache->render_passes_size,
-            cache->render_pass_count + 1, sizeof(*cache->render_passes)))
-    {
-        *vk_render_pass = VK_NULL_HANDLE;
-        return E_OUTOFMEMORY;
-    }
-
-    entry = &cache->render_passes[cache->render_pass_count];
-
-    entry->key = *key;
-
     have_depth_stencil = !!(key->flags & VKD3D_RENDER_PASS_KEY_DEPTH_STENCIL_ENABLE);
     rt_count = have_depth_stencil ? key->attachment_count - 1 : key->attachment_count;
     assert(rt_count <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
@@ -1566,12 +1605,7 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     pass_info.correlatedViewMaskCount = 0;
     pass_info.pCorrelatedViewMasks = NULL;
 
-    if ((vr = VK_CALL(vkCreateRenderPass2KHR(device->vk_device, &pass_info, NULL, vk_render_pass))) >= 0)
-    {
-        entry->vk_render_pass = *vk_render_pass;
-        ++cache->render_pass_count;
-    }
-    else
+    if ((vr = VK_CALL(vkCreateRenderPass2KHR(device->vk_device, &pass_info, NULL, vk_render_pass))) < 0)
     {
         WARN("Failed to create Vulkan render pass, vr %d.\n", vr);
         *vk_render_pass = VK_NULL_HANDLE;
@@ -1583,59 +1617,415 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
 HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
-    bool found = false;
-    HRESULT hr = S_OK;
-    unsigned int i;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_render_pass_entry entry, *e;
+    HRESULT hr;
     int rc;
 
-    if ((rc = pthread_mutex_lock(&device->mutex)))
+    /* Render passes are never removed from the cache, so lookups of
+     * existing render passes do not need to take any lock. */
+    if ((e = (struct vkd3d_render_pass_entry *)concurrent_hash_map_find(&cache->map, key)))
+    {
+        *vk_render_pass = e->vk_render_pass;
+        return S_OK;
+    }
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
     {
         ERR("Failed to lock mutex, error %d.\n", rc);
         *vk_render_pass = VK_NULL_HANDLE;
         return hresult_from_errno(rc);
     }
 
-    for (i = 0; i < cache->render_pass_count; ++i)
+    /* Another thread may have created the render pass in the meantime */
+    if ((e = (struct vkd3d_render_pass_entry *)concurrent_hash_map_find(&cache->map, key)))
+    {
+        *vk_render_pass = e->vk_render_pass;
+        pthread_mutex_unlock(&cache->mutex);
+        return S_OK;
+    }
+
+    if (SUCCEEDED(hr = vkd3d_render_pass_cache_create_pass(device, key, vk_render_pass)))
     {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
+        entry.key = *key;
+        entry.vk_render_pass = *vk_render_pass;
 
-        if (!memcmp(&current->key, key, sizeof(*key)))
+        if (!concurrent_hash_map_insert(&cache->map, key, &entry.entry))
         {
-            *vk_render_pass = current->vk_render_pass;
-            found = true;
-            break;
+            ERR("Failed to insert render pass into hash map.\n");
+            VK_CALL(vkDestroyRenderPass(device->vk_device, *vk_render_pass, NULL));
+            *vk_render_pass = VK_NULL_HANDLE;
+            hr = E_OUTOFMEMORY;
         }
     }
 
-    if (!found)
-        hr = vkd3d_render_pass_cache_create_pass_locked(cache, device, key, vk_render_pass);
-
-    pthread_mutex_unlock(&device->mutex);
-
+    pthread_mutex_unlock(&cache->mutex);
     return hr;
 }
 
-void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache)
+HRESULT vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache)
 {
-    cache->render_passes = NULL;
-    cache->render_pass_count = 0;
-    cache->render_passes_size = 0;
+    int rc;
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+        return hresult_from_errno(rc);
+
+    concurrent_hash_map_init(&cache->map, vkd3d_render_pass_entry_hash,
+            vkd3d_render_pass_entry_compare, sizeof(struct vkd3d_render_pass_entry));
+    return S_OK;
 }
 
 void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct concurrent_hash_map_table *table = cache->map.table;
+    uint32_t i;
+
+    for (i = 0; table && i < table->entry_count; i++)
+    {
+        struct vkd3d_render_pass_entry *e = (struct vkd3d_render_pass_entry *)
+                concurrent_hash_map_table_get_entry(&cache->map, table, i);
+
+        if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
+            VK_CALL(vkDestroyRenderPass(device->vk_device, e->vk_render_pass, NULL));
+    }
+
+    concurrent_hash_map_clear(&cache->map);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+/* Cached framebuffers live in their own allocation so that their address remains
+ * stable when the hash map grows, which lets views index the framebuffers they
+ * are used in. They are freed as soon as one of their views is destroyed. */
+struct vkd3d_cached_framebuffer
+{
+    VkFramebuffer vk_framebuffer;
+    struct vkd3d_framebuffer_key key;
+    struct vkd3d_view *views[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+    uint32_t view_count;
+};
+
+struct vkd3d_framebuffer_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_framebuffer_key key;
+    struct vkd3d_cached_framebuffer *framebuffer; /* atomic, NULL once evicted */
+};
+
+/* Compact the map once it holds at least this many evicted entries, and
+ * at least as many evicted entries as live ones. */
+#define VKD3D_FRAMEBUFFER_CACHE_COMPACT_THRESHOLD 64u
+
+static uint32_t vkd3d_framebuffer_entry_hash(const void *key)
+{
+    const struct vkd3d_framebuffer_key *k = key;
+    uint32_t hash;
+    unsigned int i;
+
+    hash = hash_uint64((uint64_t)k->vk_render_pass);
+    hash = hash_combine(hash, k->extent.width);
+    hash = hash_combine(hash, k->extent.height);
+    hash = hash_combine(hash, k->extent.depth);
+
+    for (i = 0; i < k->view_count; i++)
+        hash = hash_combine(hash, hash_uint64(k->view_cookies[i]));
+
+    return hash;
+}
+
+static bool vkd3d_framebuffer_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_framebuffer_entry *e = (const struct vkd3d_framebuffer_entry *)entry;
+
+    return !memcmp(&e->key, key, sizeof(e->key));
+}
+
+static bool vkd3d_framebuffer_entry_is_live(const struct hash_map_entry *entry)
+{
+    const struct vkd3d_framebuffer_entry *e = (const struct vkd3d_framebuffer_entry *)entry;
+
+    return !!e->framebuffer;
+}
+
+static void vkd3d_view_remove_framebuffer_locked(struct vkd3d_view *view,
+        const struct vkd3d_cached_framebuffer *framebuffer)
+{
+    size_t i;
+
+    for (i = 0; i < view->framebuffers_count; i++)
+    {
+        if (view->framebuffers[i] == framebuffer)
+        {
+            view->framebuffers[i] = view->framebuffers[--view->framebuffers_count];
+            /* Release, the view may get destroyed as soon as this drops to zero */
+            vkd3d_atomic_uint32_decrement(&view->framebuffer_refs, vkd3d_memory_order_release);
+            return;
+        }
+    }
+}
+
+static bool vkd3d_cached_framebuffer_attach_views_locked(struct vkd3d_cached_framebuffer *framebuffer,
+        uint32_t view_count, struct vkd3d_view * const *views)
+{
+    struct vkd3d_view *view;
+    unsigned int i;
+
+    for (i = 0; i < view_count; i++)
+    {
+        view = views[i];
+
+        if (!vkd3d_array_reserve((void **)&view->framebuffers, &view->framebuffers_size,
+                view->framebuffers_count + 1, sizeof(*view->framebuffers)))
+        {
+            while (i--)
+                vkd3d_view_remove_framebuffer_locked(views[i], framebuffer);
+            return false;
+        }
+
+        view->framebuffers[view->framebuffers_count++] = framebuffer;
+        vkd3d_atomic_uint32_increment(&view->framebuffer_refs, vkd3d_memory_order_relaxed);
+        framebuffer->views[i] = view;
+    }
+
+    framebuffer->view_count = view_count;
+    return true;
+}
+
+static VkFramebuffer vkd3d_framebuffer_cache_lookup(struct vkd3d_framebuffer_cache *cache,
+        const struct vkd3d_framebuffer_key *key)
+{
+    const struct vkd3d_cached_framebuffer *framebuffer;
+    const struct vkd3d_framebuffer_entry *e;
+    VkFramebuffer vk_framebuffer;
+
+    /* Compaction only frees retired tables while no lookup is in progress. */
+    vkd3d_atomic_uint32_increment(&cache->reader_count, vkd3d_memory_order_seq_cst);
+
+    /* Framebuffers are only evicted once one of their views is destroyed, at which
+     * point the application must not use the view anymore. */
+    if ((e = (const struct vkd3d_framebuffer_entry *)concurrent_hash_map_find(&cache->map, key)) &&
+            (framebuffer = vkd3d_atomic_ptr_load_explicit(&e->framebuffer, vkd3d_memory_order_acquire)))
+        vk_framebuffer = framebuffer->vk_framebuffer;
+    else
+        vk_framebuffer = VK_NULL_HANDLE;
+
+    vkd3d_atomic_uint32_decrement(&cache->reader_count, vkd3d_memory_order_release);
+    return vk_framebuffer;
+}
+
+static void vkd3d_framebuffer_cache_free_retired_locked(struct vkd3d_framebuffer_cache *cache)
+{
+    /* Lookups which started after the current table got published cannot see
+     * retired tables. Otherwise, try again on the next insert or eviction. */
+    if (cache->map.table && cache->map.table->retired &&
+            !vkd3d_atomic_uint32_load_explicit(&cache->reader_count, vkd3d_memory_order_seq_cst))
+        concurrent_hash_map_free_retired(&cache->map);
+}
+
+HRESULT vkd3d_framebuffer_cache_find(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device, VkRenderPass vk_render_pass, uint32_t view_count,
+        struct vkd3d_view * const *views, const VkExtent3D *extent, VkFramebuffer *vk_framebuffer)
+{
+    VkImageView vk_views[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_cached_framebuffer *framebuffer;
+    struct vkd3d_framebuffer_entry entry, *e;
+    VkFramebufferCreateInfo fb_info;
+    struct vkd3d_framebuffer_key key;
     unsigned int i;
+    VkResult vr;
+    int rc;
 
-    for (i = 0; i < cache->render_pass_count; ++i)
+    if (view_count > ARRAY_SIZE(key.view_cookies))
     {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
-        VK_CALL(vkDestroyRenderPass(device->vk_device, current->vk_render_pass, NULL));
+        ERR("Too many attachments (%u).\n", view_count);
+        return E_INVALIDARG;
     }
 
-    vkd3d_free(cache->render_passes);
-    cache->render_passes = NULL;
+    /* The key is compared with memcmp, so unused views must be cleared */
+    memset(&key, 0, sizeof(key));
+    key.vk_render_pass = vk_render_pass;
+    key.extent = *extent;
+    key.view_count = view_count;
+
+    for (i = 0; i < view_count; i++)
+        key.view_cookies[i] = views[i]->cookie;
+
+    if ((*vk_framebuffer = vkd3d_framebuffer_cache_lookup(cache, &key)))
+        return S_OK;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    /* Another thread may have created the framebuffer in the meantime */
+    if ((e = (struct vkd3d_framebuffer_entry *)concurrent_hash_map_find(&cache->map, &key)) && e->framebuffer)
+    {
+        *vk_framebuffer = e->framebuffer->vk_framebuffer;
+        pthread_mutex_unlock(&cache->mutex);
+        return S_OK;
+    }
+
+    if (!(framebuffer = vkd3d_calloc(1, sizeof(*framebuffer))))
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < view_count; i++)
+        vk_views[i] = views[i]->vk_image_view;
+
+    fb_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fb_info.pNext = NULL;
+    fb_info.flags = 0;
+    fb_info.renderPass = vk_render_pass;
+    fb_info.attachmentCount = view_count;
+    fb_info.pAttachments = vk_views;
+    fb_info.width = extent->width;
+    fb_info.height = extent->height;
+    fb_info.layers = extent->depth;
+
+    if ((vr = VK_CALL(vkCreateFramebuffer(device->vk_device, &fb_info, NULL, &framebuffer->vk_framebuffer))) < 0)
+    {
+        ERR("Failed to create Vulkan framebuffer, vr %d.\n", vr);
+        vkd3d_free(framebuffer);
+        pthread_mutex_unlock(&cache->mutex);
+        return hresult_from_vk_result(vr);
+    }
+
+    framebuffer->key = key;
+
+    if (!vkd3d_cached_framebuffer_attach_views_locked(framebuffer, view_count, views))
+    {
+        ERR("Failed to attach framebuffer to views.\n");
+        goto fail;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.key = key;
+    entry.framebuffer = framebuffer;
+
+    if (!(e = (struct vkd3d_framebuffer_entry *)concurrent_hash_map_insert(&cache->map, &key, &entry.entry)))
+    {
+        ERR("Failed to insert framebuffer into hash map.\n");
+        for (i = 0; i < view_count; i++)
+            vkd3d_view_remove_framebuffer_locked(views[i], framebuffer);
+        goto fail;
+    }
+
+    /* The key matched an evicted entry that has not been compacted away yet */
+    if (e->framebuffer != framebuffer)
+    {
+        vkd3d_atomic_ptr_store_explicit(&e->framebuffer, framebuffer, vkd3d_memory_order_release);
+        cache->dead_count--;
+    }
+
+    vkd3d_framebuffer_cache_free_retired_locked(cache);
+
+    *vk_framebuffer = framebuffer->vk_framebuffer;
+    pthread_mutex_unlock(&cache->mutex);
+    return S_OK;
+
+fail:
+    VK_CALL(vkDestroyFramebuffer(device->vk_device, framebuffer->vk_framebuffer, NULL));
+    vkd3d_free(framebuffer);
+    *vk_framebuffer = VK_NULL_HANDLE;
+    pthread_mutex_unlock(&cache->mutex);
+    return E_OUTOFMEMORY;
+}
+
+void vkd3d_framebuffer_cache_evict_view(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device, struct vkd3d_view *view)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_cached_framebuffer *framebuffer;
+    struct vkd3d_framebuffer_entry *e;
+    unsigned int i;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    /* Detaching a framebuffer removes every reference to it, including
+     * all references from this view if it is attached more than once. */
+    while (view->framebuffers_count)
+    {
+        framebuffer = view->framebuffers[view->framebuffers_count - 1];
+
+        for (i = 0; i < framebuffer->view_count; i++)
+            vkd3d_view_remove_framebuffer_locked(framebuffer->views[i], framebuffer);
+
+        if ((e = (struct vkd3d_framebuffer_entry *)concurrent_hash_map_find(&cache->map, &framebuffer->key)))
+        {
+            vkd3d_atomic_ptr_store_explicit(&e->framebuffer, NULL, vkd3d_memory_order_relaxed);
+            cache->dead_count++;
+        }
+
+        /* Views only get destroyed once the GPU is done with them, and
+         * the same holds for framebuffers that reference those views. */
+        VK_CALL(vkDestroyFramebuffer(device->vk_device, framebuffer->vk_framebuffer, NULL));
+        vkd3d_free(framebuffer);
+    }
+
+    vkd3d_free(view->framebuffers);
+    view->framebuffers = NULL;
+    view->framebuffers_size = 0;
+
+    if (cache->dead_count >= VKD3D_FRAMEBUFFER_CACHE_COMPACT_THRESHOLD &&
+            2 * cache->dead_count >= cache->map.table->used_count)
+    {
+        if (concurrent_hash_map_compact(&cache->map, vkd3d_framebuffer_entry_is_live))
+            cache->dead_count = 0;
+        else
+            ERR("Failed to compact framebuffer cache.\n");
+    }
+
+    vkd3d_framebuffer_cache_free_retired_locked(cache);
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+HRESULT vkd3d_framebuffer_cache_init(struct vkd3d_framebuffer_cache *cache)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+        return hresult_from_errno(rc);
+
+    concurrent_hash_map_init(&cache->map, vkd3d_framebuffer_entry_hash,
+            vkd3d_framebuffer_entry_compare, sizeof(struct vkd3d_framebuffer_entry));
+    cache->dead_count = 0;
+    cache->reader_count = 0;
+    return S_OK;
+}
+
+void vkd3d_framebuffer_cache_cleanup(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct concurrent_hash_map_table *table = cache->map.table;
+    struct vkd3d_framebuffer_entry *e;
+    uint32_t i;
+
+    for (i = 0; table && i < table->entry_count; i++)
+    {
+        e = (struct vkd3d_framebuffer_entry *)concurrent_hash_map_table_get_entry(&cache->map, table, i);
+
+        if (!(e->entry.flags & HASH_MAP_ENTRY_OCCUPIED) || !e->framebuffer)
+            continue;
+
+        VK_CALL(vkDestroyFramebuffer(device->vk_device, e->framebuffer->vk_framebuffer, NULL));
+        vkd3d_free(e->framebuffer);
+    }
+
+    concurrent_hash_map_clear(&cache->map);
+    pthread_mutex_destroy(&cache->mutex);
 }
 
 static void d3d12_promote_depth_stencil_desc(D3D12_DEPTH_STENCIL_DESC1 *out, const D3D12_DEPTH_STENCIL_DESC *in)
@@ -1833,15 +2223,41 @@ HRESULT vkd3d_pipeline_state_desc_from_d3d12_stream_desc(struct d3d12_pipeline_s
 #undef VKD3D_HANDLE_SUBOBJECT
 #undef VKD3D_HANDLE_SUBOBJECT_EXPLICIT
 
+enum vkd3d_compiled_pipeline_status
+{
+    VKD3D_COMPILED_PIPELINE_READY = 0,
+    VKD3D_COMPILED_PIPELINE_PENDING = 1,
+    VKD3D_COMPILED_PIPELINE_FAILED = 2,
+    VKD3D_COMPILED_PIPELINE_COMPILING = 3,
+};
+
 struct vkd3d_compiled_pipeline
 {
-    struct list entry;
     struct vkd3d_pipeline_key key;
+    uint32_t hash;
+    /* Pending entries are placeholders for variants which are queued for compilation,
+     * only a worker moves them to COMPILING. FAILED entries are retried by whichever
+     * recording thread moves them to COMPILING. The pipeline fields are only valid once status is READY. */
+    uint32_t status;
     VkPipeline vk_pipeline;
     VkRenderPass vk_render_pass;
     uint32_t dynamic_state_flags;
 };
 
+/* Open-addressing table which is only ever appended to. Readers probe it without taking any locks.
+ * When the table needs to grow, a new table is published atomically, and the old one is kept alive
+ * in the retired chain until the pipeline state is destroyed, since concurrent readers may still
+ * be probing it. Tables grow geometrically, so the retired tables cost at most as much as the live one. */
+struct vkd3d_compiled_pipeline_table
+{
+    struct vkd3d_compiled_pipeline_table *retired;
+    uint32_t size;
+    uint32_t count;
+    struct vkd3d_compiled_pipeline *entries[];
+};
+
+#define VKD3D_COMPILED_PIPELINE_TABLE_INITIAL_SIZE 16u
+
 /* ID3D12PipelineState */
 static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12PipelineState *iface)
 {
@@ -1885,7 +2301,7 @@ static void d3d12_pipeline_state_destroy_graphics(struct d3d12_pipeline_state *s
 {
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    struct vkd3d_compiled_pipeline *current, *e;
+    struct vkd3d_compiled_pipeline_table *table, *retired;
     unsigned int i;
 
     for (i = 0; i < graphics->stage_count; ++i)
@@ -1893,10 +2309,23 @@ static void d3d12_pipeline_state_destroy_graphics(struct d3d12_pipeline_state *s
         VK_CALL(vkDestroyShaderModule(device->vk_device, graphics->stages[i].module, NULL));
     }
 
-    LIST_FOR_EACH_ENTRY_SAFE(current, e, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    if ((table = graphics->compiled_fallback_pipelines))
+    {
+        for (i = 0; i < table->size; i++)
+        {
+            if (table->entries[i])
+            {
+                VK_CALL(vkDestroyPipeline(device->vk_device, table->entries[i]->vk_pipeline, NULL));
+                vkd3d_free(table->entries[i]);
+            }
+        }
+    }
+
+    while (table)
     {
-        VK_CALL(vkDestroyPipeline(device->vk_device, current->vk_pipeline, NULL));
-        vkd3d_free(current);
+        retired = table->retired;
+        vkd3d_free(table);
+        table = retired;
     }
 
     for (i = 0; i < VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT; i++)
@@ -1927,7 +2356,11 @@ static ULONG STDMETHODCALLTYPE d3d12_pipeline_state_Release(ID3D12PipelineState
         vkd3d_private_store_destroy(&state->private_store);
 
         if (d3d12_pipeline_state_is_graphics(state))
+        {
+            if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE)
+                vkd3d_pipeline_compile_pool_cancel(&device->pipeline_compile_pool, state);
             d3d12_pipeline_state_destroy_graphics(state, device);
+        }
         else if (d3d12_pipeline_state_is_compute(state))
             VK_CALL(vkDestroyPipeline(device->vk_device, state->compute.vk_pipeline, NULL));
 
@@ -3361,7 +3794,8 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
         }
     }
 
-    list_init(&graphics->compiled_fallback_pipelines);
+    graphics->compiled_fallback_pipelines = NULL;
+    spinlock_init(&graphics->compiled_fallback_lock);
 
     if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
         goto fail;
@@ -3560,77 +3994,116 @@ enum VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_TOPOLOG
     }
 }
 
-static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(const struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, VkRenderPass *vk_render_pass, uint32_t *dynamic_state_flags)
+static uint32_t vkd3d_pipeline_key_hash(const struct vkd3d_pipeline_key *key)
 {
-    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct d3d12_device *device = state->device;
-    VkPipeline vk_pipeline = VK_NULL_HANDLE;
-    struct vkd3d_compiled_pipeline *current;
-    int rc;
+    uint32_t hash;
+    unsigned int i;
 
-    *vk_render_pass = VK_NULL_HANDLE;
+    hash = hash_combine((uint32_t)key->topology, key->viewport_count);
+    hash = hash_combine(hash, (uint32_t)key->dsv_format);
+    hash = hash_combine(hash, (key->dynamic_stride ? 1u : 0u) |
+            (key->dynamic_viewport ? 2u : 0u) |
+            (key->dynamic_topology ? 4u : 0u));
 
-    if (!(rc = pthread_mutex_lock(&device->mutex)))
+    if (!key->dynamic_stride)
     {
-        LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
-        {
-            if (!memcmp(&current->key, key, sizeof(*key)))
-            {
-                vk_pipeline = current->vk_pipeline;
-                *vk_render_pass = current->vk_render_pass;
-                *dynamic_state_flags = current->dynamic_state_flags;
-                break;
-            }
-        }
-        pthread_mutex_unlock(&device->mutex);
+        for (i = 0; i < ARRAY_SIZE(key->strides); i++)
+            hash = hash_combine(hash, key->strides[i]);
     }
-    else
+
+    return hash;
+}
+
+static struct vkd3d_compiled_pipeline *vkd3d_compiled_pipeline_table_find(
+        const struct vkd3d_compiled_pipeline_table *table, const struct vkd3d_pipeline_key *key, uint32_t hash)
+{
+    struct vkd3d_compiled_pipeline *entry;
+    uint32_t mask = table->size - 1;
+    uint32_t idx = hash & mask;
+
+    /* The table is never more than half full, so this is guaranteed to terminate. */
+    while ((entry = vkd3d_atomic_ptr_load_explicit(&table->entries[idx], vkd3d_memory_order_acquire)))
     {
-        ERR("Failed to lock mutex, error %d.\n", rc);
+        if (entry->hash == hash && !memcmp(&entry->key, key, sizeof(*key)))
+            return entry;
+        idx = (idx + 1) & mask;
     }
 
-    return vk_pipeline;
+    return NULL;
+}
+
+static void vkd3d_compiled_pipeline_table_add(struct vkd3d_compiled_pipeline_table *table,
+        struct vkd3d_compiled_pipeline *compiled_pipeline)
+{
+    uint32_t mask = table->size - 1;
+    uint32_t idx = compiled_pipeline->hash & mask;
+
+    while (table->entries[idx])
+        idx = (idx + 1) & mask;
+
+    /* Publish the fully initialized entry to lock-free readers. */
+    vkd3d_atomic_ptr_store_explicit(&table->entries[idx], compiled_pipeline, vkd3d_memory_order_release);
+    table->count++;
 }
 
-static bool d3d12_pipeline_state_put_pipeline_to_cache(struct d3d12_pipeline_state *state,
-        const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline, VkRenderPass vk_render_pass,
-        uint32_t dynamic_state_flags)
+static struct vkd3d_compiled_pipeline *d3d12_pipeline_state_find_compiled_pipeline(
+        const struct d3d12_pipeline_state *state, const struct vkd3d_pipeline_key *key, uint32_t hash)
 {
+    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    const struct vkd3d_compiled_pipeline_table *table;
+
+    table = vkd3d_atomic_ptr_load_explicit(&graphics->compiled_fallback_pipelines, vkd3d_memory_order_acquire);
+    return table ? vkd3d_compiled_pipeline_table_find(table, key, hash) : NULL;
+}
+
+/* Returns the entry which ended up in the table. If another thread raced us, that will be
+ * the entry inserted by the other thread, and the caller is responsible for freeing its own. */
+static struct vkd3d_compiled_pipeline *d3d12_pipeline_state_insert_compiled_pipeline(
+        struct d3d12_pipeline_state *state, struct vkd3d_compiled_pipeline *compiled_pipeline)
+{
+    struct vkd3d_compiled_pipeline_table *table, *new_table;
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct vkd3d_compiled_pipeline *compiled_pipeline, *current;
-    struct d3d12_device *device = state->device;
-    int rc;
+    const struct vkd3d_compiled_pipeline *existing;
+    uint32_t new_size, i;
 
-    if (!(compiled_pipeline = vkd3d_malloc(sizeof(*compiled_pipeline))))
-        return false;
+    spinlock_acquire(&graphics->compiled_fallback_lock);
 
-    compiled_pipeline->key = *key;
-    compiled_pipeline->vk_pipeline = vk_pipeline;
-    compiled_pipeline->vk_render_pass = vk_render_pass;
-    compiled_pipeline->dynamic_state_flags = dynamic_state_flags;
+    table = graphics->compiled_fallback_pipelines;
 
-    if ((rc = pthread_mutex_lock(&device->mutex)))
+    if (table && (existing = vkd3d_compiled_pipeline_table_find(table, &compiled_pipeline->key, compiled_pipeline->hash)))
     {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        vkd3d_free(compiled_pipeline);
-        return false;
+        spinlock_release(&graphics->compiled_fallback_lock);
+        return (struct vkd3d_compiled_pipeline *)existing;
     }
 
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    if (!table || 2 * (table->count + 1) > table->size)
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
+        new_size = table ? 2 * table->size : VKD3D_COMPILED_PIPELINE_TABLE_INITIAL_SIZE;
+
+        if (!(new_table = vkd3d_calloc(1, sizeof(*new_table) + new_size * sizeof(*new_table->entries))))
         {
-            vkd3d_free(compiled_pipeline);
-            compiled_pipeline = NULL;
-            break;
+            spinlock_release(&graphics->compiled_fallback_lock);
+            return NULL;
         }
-    }
 
-    if (compiled_pipeline)
-        list_add_tail(&graphics->compiled_fallback_pipelines, &compiled_pipeline->entry);
+        new_table->retired = table;
+        new_table->size = new_size;
+
+        if (table)
+        {
+            for (i = 0; i < table->size; i++)
+            {
+                if (table->entries[i])
+                    vkd3d_compiled_pipeline_table_add(new_table, table->entries[i]);
+            }
+        }
 
-    pthread_mutex_unlock(&device->mutex);
+        vkd3d_atomic_ptr_store_explicit(&graphics->compiled_fallback_pipelines, new_table, vkd3d_memory_order_release);
+        table = new_table;
+    }
+
+    vkd3d_compiled_pipeline_table_add(table, compiled_pipeline);
+    spinlock_release(&graphics->compiled_fallback_lock);
     return compiled_pipeline;
 }
 
@@ -3819,41 +4292,92 @@ VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
     return state->graphics.pipeline[variant_flags];
 }
 
-VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
-        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, VkRenderPass *vk_render_pass,
-        uint32_t *dynamic_state_flags, uint32_t variant_flags)
+static VkPipeline d3d12_pipeline_state_get_compiled_pipeline(const struct vkd3d_compiled_pipeline *compiled_pipeline,
+        VkRenderPass *vk_render_pass, uint32_t *dynamic_state_flags)
+{
+    uint32_t status = vkd3d_atomic_uint32_load_explicit((uint32_t *)&compiled_pipeline->status, vkd3d_memory_order_acquire);
+
+    *vk_render_pass = VK_NULL_HANDLE;
+
+    if (status != VKD3D_COMPILED_PIPELINE_READY)
+        return VK_NULL_HANDLE;
+
+    *vk_render_pass = compiled_pipeline->vk_render_pass;
+    *dynamic_state_flags = compiled_pipeline->dynamic_state_flags;
+    return compiled_pipeline->vk_pipeline;
+}
+
+static void d3d12_pipeline_state_compile_pipeline_entry(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *compiled_pipeline, uint32_t variant_flags);
+static bool vkd3d_pipeline_compile_pool_enqueue(struct vkd3d_pipeline_compile_pool *pool,
+        struct d3d12_pipeline_state *state, struct vkd3d_compiled_pipeline *compiled_pipeline, uint32_t variant_flags);
+static void vkd3d_pipeline_compile_pool_wait(struct vkd3d_pipeline_compile_pool *pool,
+        struct vkd3d_compiled_pipeline *compiled_pipeline);
+
+static VkPipeline d3d12_pipeline_state_resolve_compiled_pipeline(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *compiled_pipeline, uint32_t variant_flags,
+        VkRenderPass *vk_render_pass, uint32_t *dynamic_state_flags)
+{
+    bool retried = false;
+    uint32_t status;
+
+    VKD3D_REGION_DECL(pipeline_compile_sync);
+
+    /* Draws cannot be skipped, so wait for variants which were queued ahead of time.
+     * Queued jobs are left to the workers, since the compile has been started before the draw.
+     * Variants which could not be queued or failed on a worker are retried once on this thread. */
+    while ((status = vkd3d_atomic_uint32_load_explicit(&compiled_pipeline->status,
+            vkd3d_memory_order_acquire)) != VKD3D_COMPILED_PIPELINE_READY)
+    {
+        if (status != VKD3D_COMPILED_PIPELINE_FAILED)
+        {
+            vkd3d_pipeline_compile_pool_wait(&state->device->pipeline_compile_pool, compiled_pipeline);
+        }
+        else if (retried)
+        {
+            break;
+        }
+        else if (vkd3d_atomic_uint32_compare_exchange(&compiled_pipeline->status, status,
+                VKD3D_COMPILED_PIPELINE_COMPILING, vkd3d_memory_order_acquire, vkd3d_memory_order_acquire) == status)
+        {
+            VKD3D_REGION_BEGIN(pipeline_compile_sync);
+            d3d12_pipeline_state_compile_pipeline_entry(state, compiled_pipeline, variant_flags);
+            VKD3D_REGION_END(pipeline_compile_sync);
+            retried = true;
+        }
+    }
+
+    return d3d12_pipeline_state_get_compiled_pipeline(compiled_pipeline, vk_render_pass, dynamic_state_flags);
+}
+
+static uint32_t d3d12_pipeline_state_init_pipeline_key(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, struct vkd3d_pipeline_key *pipeline_key)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct d3d12_device *device = state->device;
-    struct vkd3d_pipeline_key pipeline_key;
     uint32_t stride, stride_align_mask;
     bool extended_dynamic_state;
-    VkPipeline vk_pipeline;
     unsigned int i;
 
-    assert(d3d12_pipeline_state_is_graphics(state));
-
-    memset(&pipeline_key, 0, sizeof(pipeline_key));
+    memset(pipeline_key, 0, sizeof(*pipeline_key));
 
     /* Try to keep as much dynamic state as possible so we don't have to rebind state unnecessarily. */
-    extended_dynamic_state = device->device_info.extended_dynamic_state_features.extendedDynamicState;
+    extended_dynamic_state = state->device->device_info.extended_dynamic_state_features.extendedDynamicState;
 
     if (extended_dynamic_state &&
         graphics->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH &&
         graphics->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED)
-        pipeline_key.dynamic_topology = true;
+        pipeline_key->dynamic_topology = true;
     else
-        pipeline_key.topology = dyn_state->primitive_topology;
+        pipeline_key->topology = dyn_state->primitive_topology;
 
     if (extended_dynamic_state)
-        pipeline_key.dynamic_viewport = true;
+        pipeline_key->dynamic_viewport = true;
     else
-        pipeline_key.viewport_count = max(dyn_state->viewport_count, 1);
+        pipeline_key->viewport_count = max(dyn_state->viewport_count, 1);
 
     if (extended_dynamic_state && d3d12_pipeline_state_can_use_dynamic_stride(state, dyn_state))
     {
-        pipeline_key.dynamic_stride = true;
+        pipeline_key->dynamic_stride = true;
     }
     else
     {
@@ -3867,39 +4391,355 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
                         stride, stride_align_mask + 1);
                 stride &= ~stride_align_mask;
             }
-            pipeline_key.strides[i] = stride;
+            pipeline_key->strides[i] = stride;
         }
     }
 
-    pipeline_key.dsv_format = dsv_format;
+    pipeline_key->dsv_format = dsv_format;
+    return vkd3d_pipeline_key_hash(pipeline_key);
+}
+
+void d3d12_pipeline_state_prefetch_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, uint32_t variant_flags)
+{
+    struct vkd3d_compiled_pipeline *compiled_pipeline, *new_pipeline;
+    struct vkd3d_pipeline_key pipeline_key;
+    uint32_t dynamic_state_flags;
+    VkRenderPass vk_render_pass;
+    uint32_t pipeline_hash;
+
+    if (!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE) || !d3d12_pipeline_state_is_graphics(state))
+        return;
+
+    if (d3d12_pipeline_state_get_pipeline(state, dyn_state, dsv_format,
+            &vk_render_pass, &dynamic_state_flags, variant_flags))
+        return;
+
+    pipeline_hash = d3d12_pipeline_state_init_pipeline_key(state, dyn_state, dsv_format, &pipeline_key);
+    if (d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, pipeline_hash))
+        return;
+
+    if (!(new_pipeline = vkd3d_malloc(sizeof(*new_pipeline))))
+        return;
+
+    /* Publish a placeholder first, so that only one compile is queued per variant. */
+    new_pipeline->key = pipeline_key;
+    new_pipeline->hash = pipeline_hash;
+    new_pipeline->status = VKD3D_COMPILED_PIPELINE_PENDING;
+    new_pipeline->vk_pipeline = VK_NULL_HANDLE;
+    new_pipeline->vk_render_pass = VK_NULL_HANDLE;
+    new_pipeline->dynamic_state_flags = 0;
+
+    if ((compiled_pipeline = d3d12_pipeline_state_insert_compiled_pipeline(state, new_pipeline)) != new_pipeline)
+    {
+        vkd3d_free(new_pipeline);
+        return;
+    }
+
+    /* Draws must not wait for a job which is never going to run. */
+    if (!vkd3d_pipeline_compile_pool_enqueue(&state->device->pipeline_compile_pool, state, new_pipeline, variant_flags))
+    {
+        vkd3d_atomic_uint32_store_explicit(&new_pipeline->status,
+                VKD3D_COMPILED_PIPELINE_FAILED, vkd3d_memory_order_release);
+    }
+}
+
+VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, VkRenderPass *vk_render_pass,
+        uint32_t *dynamic_state_flags, uint32_t variant_flags)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &state->device->vk_procs;
+    struct vkd3d_compiled_pipeline *compiled_pipeline, *new_pipeline;
+    struct d3d12_device *device = state->device;
+    struct vkd3d_pipeline_key pipeline_key;
+    uint32_t pipeline_hash;
+    VkPipeline vk_pipeline;
+
+    VKD3D_REGION_DECL(pipeline_compile_sync);
+
+    assert(d3d12_pipeline_state_is_graphics(state));
 
-    if ((vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, vk_render_pass,
-            dynamic_state_flags)))
+    pipeline_hash = d3d12_pipeline_state_init_pipeline_key(state, dyn_state, dsv_format, &pipeline_key);
+
+    if ((compiled_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, pipeline_hash)))
     {
-        return vk_pipeline;
+        return d3d12_pipeline_state_resolve_compiled_pipeline(state, compiled_pipeline,
+                variant_flags, vk_render_pass, dynamic_state_flags);
     }
 
-    if (extended_dynamic_state)
+    if (device->device_info.extended_dynamic_state_features.extendedDynamicState)
         FIXME("Extended dynamic state is supported, but compiling a fallback pipeline late!\n");
 
+    if (!(new_pipeline = vkd3d_malloc(sizeof(*new_pipeline))))
+        return VK_NULL_HANDLE;
+
+    VKD3D_REGION_BEGIN(pipeline_compile_sync);
     vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
             &pipeline_key, dsv_format, VK_NULL_HANDLE, vk_render_pass, dynamic_state_flags,
             variant_flags);
+    VKD3D_REGION_END(pipeline_compile_sync);
 
     if (!vk_pipeline)
     {
         ERR("Failed to create pipeline.\n");
+        vkd3d_free(new_pipeline);
         return VK_NULL_HANDLE;
     }
 
-    if (d3d12_pipeline_state_put_pipeline_to_cache(state, &pipeline_key, vk_pipeline, *vk_render_pass, *dynamic_state_flags))
-        return vk_pipeline;
-    /* Other thread compiled the pipeline before us. */
-    VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
-    vk_pipeline = d3d12_pipeline_state_find_compiled_pipeline(state, &pipeline_key, vk_render_pass, dynamic_state_flags);
-    if (!vk_pipeline)
-        ERR("Could not get the pipeline compiled by other thread from the cache.\n");
-    return vk_pipeline;
+    new_pipeline->key = pipeline_key;
+    new_pipeline->hash = pipeline_hash;
+    new_pipeline->status = VKD3D_COMPILED_PIPELINE_READY;
+    new_pipeline->vk_pipeline = vk_pipeline;
+    new_pipeline->vk_render_pass = *vk_render_pass;
+    new_pipeline->dynamic_state_flags = *dynamic_state_flags;
+
+    compiled_pipeline = d3d12_pipeline_state_insert_compiled_pipeline(state, new_pipeline);
+
+    if (compiled_pipeline != new_pipeline)
+    {
+        /* Other thread compiled the pipeline before us, or we failed to allocate a table entry. */
+        VK_CALL(vkDestroyPipeline(device->vk_device, vk_pipeline, NULL));
+        vkd3d_free(new_pipeline);
+        if (!compiled_pipeline)
+        {
+            ERR("Failed to insert pipeline into the cache.\n");
+            return VK_NULL_HANDLE;
+        }
+
+        /* The other thread may have only queued the variant. */
+        return d3d12_pipeline_state_resolve_compiled_pipeline(state, compiled_pipeline,
+                variant_flags, vk_render_pass, dynamic_state_flags);
+    }
+
+    return d3d12_pipeline_state_get_compiled_pipeline(compiled_pipeline, vk_render_pass, dynamic_state_flags);
+}
+
+static void d3d12_pipeline_state_compile_pipeline_entry(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *compiled_pipeline, uint32_t variant_flags)
+{
+    VkRenderPass vk_render_pass;
+    uint32_t dynamic_state_flags;
+    VkPipeline vk_pipeline;
+
+    vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state, &compiled_pipeline->key,
+            compiled_pipeline->key.dsv_format, VK_NULL_HANDLE, &vk_render_pass, &dynamic_state_flags,
+            variant_flags);
+
+    if (vk_pipeline)
+    {
+        compiled_pipeline->vk_pipeline = vk_pipeline;
+        compiled_pipeline->vk_render_pass = vk_render_pass;
+        compiled_pipeline->dynamic_state_flags = dynamic_state_flags;
+    }
+    else
+    {
+        ERR("Failed to create pipeline.\n");
+    }
+
+    /* Publish under the lock, so that waiters cannot miss the wakeup. */
+    pthread_mutex_lock(&state->device->pipeline_compile_pool.lock);
+    vkd3d_atomic_uint32_store_explicit(&compiled_pipeline->status, vk_pipeline ?
+            VKD3D_COMPILED_PIPELINE_READY : VKD3D_COMPILED_PIPELINE_FAILED, vkd3d_memory_order_release);
+    pthread_cond_broadcast(&state->device->pipeline_compile_pool.idle_cond);
+    pthread_mutex_unlock(&state->device->pipeline_compile_pool.lock);
+}
+
+struct vkd3d_pipeline_compile_job
+{
+    struct d3d12_pipeline_state *state;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+    uint32_t variant_flags;
+};
+
+static bool vkd3d_pipeline_compile_pool_enqueue(struct vkd3d_pipeline_compile_pool *pool,
+        struct d3d12_pipeline_state *state, struct vkd3d_compiled_pipeline *compiled_pipeline, uint32_t variant_flags)
+{
+    struct vkd3d_pipeline_compile_job *job, *new_jobs;
+    size_t new_size, i;
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (pool->job_count == pool->jobs_size)
+    {
+        /* Unwrap the ring into the new allocation. */
+        new_size = max(pool->jobs_size * 2, 16);
+
+        if (!(new_jobs = vkd3d_malloc(new_size * sizeof(*new_jobs))))
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return false;
+        }
+
+        for (i = 0; i < pool->job_count; i++)
+            new_jobs[i] = pool->jobs[(pool->job_head + i) % pool->jobs_size];
+
+        vkd3d_free(pool->jobs);
+        pool->jobs = new_jobs;
+        pool->jobs_size = new_size;
+        pool->job_head = 0;
+    }
+
+    job = &pool->jobs[(pool->job_head + pool->job_count++) % pool->jobs_size];
+    job->state = state;
+    job->compiled_pipeline = compiled_pipeline;
+    job->variant_flags = variant_flags;
+
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+    return true;
+}
+
+void vkd3d_pipeline_compile_pool_cancel(struct vkd3d_pipeline_compile_pool *pool,
+        struct d3d12_pipeline_state *state)
+{
+    bool busy;
+    size_t i, j;
+
+    pthread_mutex_lock(&pool->lock);
+
+    /* Queued jobs are simply dropped, their placeholders are freed with the pipeline state. */
+    for (i = 0, j = 0; i < pool->job_count; i++)
+    {
+        const struct vkd3d_pipeline_compile_job *job = &pool->jobs[(pool->job_head + i) % pool->jobs_size];
+
+        if (job->state != state)
+            pool->jobs[(pool->job_head + j++) % pool->jobs_size] = *job;
+    }
+    pool->job_count = j;
+
+    /* Jobs do not hold a reference to the pipeline state, so wait for in-flight compiles. */
+    do
+    {
+        for (i = 0, busy = false; i < pool->worker_count; i++)
+            busy = busy || pool->workers[i].active_state == state;
+        if (busy)
+            pthread_cond_wait(&pool->idle_cond, &pool->lock);
+    } while (busy);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void *vkd3d_pipeline_compile_worker_main(void *userdata)
+{
+    struct vkd3d_pipeline_compile_worker *worker = userdata;
+    struct vkd3d_pipeline_compile_pool *pool = worker->pool;
+    struct vkd3d_pipeline_compile_job job;
+
+    VKD3D_REGION_DECL(pipeline_compile_async);
+
+    vkd3d_set_thread_name("vkd3d_pso_comp");
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;)
+    {
+        while (!pool->job_count && !pool->should_exit)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+
+        if (pool->should_exit)
+            break;
+
+        job = pool->jobs[pool->job_head];
+        pool->job_head = (pool->job_head + 1) % pool->jobs_size;
+        pool->job_count -= 1;
+        worker->active_state = job.state;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        vkd3d_atomic_uint32_store_explicit(&job.compiled_pipeline->status,
+                VKD3D_COMPILED_PIPELINE_COMPILING, vkd3d_memory_order_relaxed);
+
+        VKD3D_REGION_BEGIN(pipeline_compile_async);
+        d3d12_pipeline_state_compile_pipeline_entry(job.state, job.compiled_pipeline, job.variant_flags);
+        VKD3D_REGION_END(pipeline_compile_async);
+
+        pthread_mutex_lock(&pool->lock);
+
+        worker->active_state = NULL;
+        pthread_cond_broadcast(&pool->idle_cond);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void vkd3d_pipeline_compile_pool_wait(struct vkd3d_pipeline_compile_pool *pool,
+        struct vkd3d_compiled_pipeline *compiled_pipeline)
+{
+    uint32_t status;
+
+    pthread_mutex_lock(&pool->lock);
+    while ((status = vkd3d_atomic_uint32_load_explicit(&compiled_pipeline->status, vkd3d_memory_order_acquire)) ==
+            VKD3D_COMPILED_PIPELINE_PENDING || status == VKD3D_COMPILED_PIPELINE_COMPILING)
+        pthread_cond_wait(&pool->idle_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+HRESULT vkd3d_pipeline_compile_pool_init(struct vkd3d_pipeline_compile_pool *pool, struct d3d12_device *device)
+{
+    unsigned int i, thread_count;
+    HRESULT hr;
+    int rc;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->device = device;
+
+    if ((rc = pthread_mutex_init(&pool->lock, NULL)))
+        return hresult_from_errno(rc);
+
+    if ((rc = pthread_cond_init(&pool->cond, NULL)))
+    {
+        pthread_mutex_destroy(&pool->lock);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&pool->idle_cond, NULL)))
+    {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        return hresult_from_errno(rc);
+    }
+
+    /* Leave the remaining cores to the application's recording threads. */
+    thread_count = max(vkd3d_get_cpu_count() / 2, 1);
+    thread_count = min(thread_count, ARRAY_SIZE(pool->workers));
+
+    for (i = 0; i < thread_count; i++)
+    {
+        pool->workers[i].pool = pool;
+        if (FAILED(hr = vkd3d_create_thread(device->vkd3d_instance,
+                vkd3d_pipeline_compile_worker_main, &pool->workers[i], &pool->workers[i].thread)))
+        {
+            ERR("Failed to create pipeline compile thread, hr %#x.\n", hr);
+            pool->worker_count = i;
+            vkd3d_pipeline_compile_pool_cleanup(pool, device);
+            return hr;
+        }
+    }
+
+    pool->worker_count = i;
+    return S_OK;
+}
+
+void vkd3d_pipeline_compile_pool_cleanup(struct vkd3d_pipeline_compile_pool *pool, struct d3d12_device *device)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->should_exit = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->worker_count; i++)
+        vkd3d_join_thread(device->vkd3d_instance, &pool->workers[i].thread);
+
+    /* Every pipeline state holds a device reference, so there cannot be any jobs left. */
+    assert(!pool->job_count);
+    vkd3d_free(pool->jobs);
+
+    pthread_cond_destroy(&pool->idle_cond);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
 }
 
 static uint32_t d3d12_max_descriptor_count_from_heap_type(D3D12_DESCRIPTOR_HEAP_TYPE heap_type)
@@ -4191,8 +5031,11 @@ static uint32_t vkd3d_bindless_state_get_bindless_flags(struct d3d12_device *dev
         /* CBV's really require push descriptors on NVIDIA to get maximum performance.
          * The difference in performance is profound (~15% in some cases).
          * On ACO, BDA with NonWritable can be promoted directly to scalar loads,
-         * which is great. */
-        if (device_info->properties2.properties.vendorID != VKD3D_VENDOR_ID_NVIDIA)
+         * which is great.
+         * Without push descriptors, a root CBV descriptor would have to be written
+         * into a new descriptor set on every update, so prefer BDA there as well. */
+        if (device_info->properties2.properties.vendorID != VKD3D_VENDOR_ID_NVIDIA ||
+                !vk_info->KHR_push_descriptor)
             flags |= VKD3D_RAW_VA_ROOT_DESCRIPTOR_CBV;
     }
 
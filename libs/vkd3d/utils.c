@@ -398,6 +398,60 @@ static void vkd3d_cleanup_depth_stencil_formats(struct d3d12_device *device)
     device->depth_stencil_formats = NULL;
 }
 
+static void vkd3d_init_format_table(struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_format_table *table = &device->format_table;
+    const struct vkd3d_format *format;
+    DXGI_FORMAT dxgi_format;
+    unsigned int i;
+
+    memset(table, 0, sizeof(*table));
+
+    for (i = 0; i < ARRAY_SIZE(vkd3d_formats); ++i)
+    {
+        dxgi_format = vkd3d_formats[i].dxgi_format;
+        assert(dxgi_format < VKD3D_DXGI_FORMAT_COUNT);
+        table->formats[dxgi_format] = &vkd3d_formats[i];
+    }
+
+    for (i = 0; i < ARRAY_SIZE(vkd3d_depth_stencil_formats); ++i)
+    {
+        dxgi_format = device->depth_stencil_formats[i].dxgi_format;
+        assert(dxgi_format < VKD3D_DXGI_FORMAT_COUNT);
+        table->depth_stencil_formats[dxgi_format] = &device->depth_stencil_formats[i];
+    }
+
+    /* The first matching entry wins, same as a linear search would. */
+    for (i = ARRAY_SIZE(vkd3d_format_compatibility_info); i; --i)
+    {
+        dxgi_format = vkd3d_format_compatibility_info[i - 1].format;
+        assert(dxgi_format < VKD3D_DXGI_FORMAT_COUNT);
+        table->typeless_formats[dxgi_format] = vkd3d_format_compatibility_info[i - 1].typeless_format;
+    }
+
+    for (i = 0; i < VKD3D_DXGI_FORMAT_COUNT; ++i)
+    {
+        if (!(format = table->depth_stencil_formats[i]))
+            format = table->formats[i];
+
+        if (!format)
+            table->typeless_formats[i] = DXGI_FORMAT_UNKNOWN;
+        else if (format->type == VKD3D_FORMAT_TYPE_TYPELESS)
+            table->typeless_formats[i] = i;
+
+        /* Format support queries prefer the color format. */
+        if (!(format = table->formats[i]))
+            format = table->depth_stencil_formats[i];
+
+        if (format)
+        {
+            VK_CALL(vkGetPhysicalDeviceFormatProperties(device->vk_physical_device,
+                    format->vk_format, &table->properties[i]));
+        }
+    }
+}
+
 HRESULT vkd3d_init_format_info(struct d3d12_device *device)
 {
     HRESULT hr;
@@ -406,8 +460,12 @@ HRESULT vkd3d_init_format_info(struct d3d12_device *device)
         return hr;
 
     if FAILED(hr = vkd3d_init_format_compatibility_lists(device))
+    {
         vkd3d_cleanup_depth_stencil_formats(device);
+        return hr;
+    }
 
+    vkd3d_init_format_table(device);
     return hr;
 }
 
@@ -421,32 +479,25 @@ void vkd3d_cleanup_format_info(struct d3d12_device *device)
  * properly support typeless formats because depth/stencil formats are only
  * compatible with themselves in Vulkan.
  */
-static const struct vkd3d_format *vkd3d_get_depth_stencil_format(const struct d3d12_device *device,
-        DXGI_FORMAT dxgi_format)
+const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
+        DXGI_FORMAT dxgi_format, bool depth_stencil)
 {
-    const struct vkd3d_format *formats;
+    const struct vkd3d_format *format;
     unsigned int i;
 
-    assert(device);
-    formats = device->depth_stencil_formats;
-
-    for (i = 0; i < ARRAY_SIZE(vkd3d_depth_stencil_formats); ++i)
+    if (device)
     {
-        if (formats[i].dxgi_format == dxgi_format)
-            return &formats[i];
-    }
+        if ((unsigned int)dxgi_format >= VKD3D_DXGI_FORMAT_COUNT)
+            return NULL;
 
-    return NULL;
-}
+        if (depth_stencil && (format = device->format_table.depth_stencil_formats[dxgi_format]))
+            return format;
 
-const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
-        DXGI_FORMAT dxgi_format, bool depth_stencil)
-{
-    const struct vkd3d_format *format;
-    unsigned int i;
+        return device->format_table.formats[dxgi_format];
+    }
 
-    if (depth_stencil && (format = vkd3d_get_depth_stencil_format(device, dxgi_format)))
-        return format;
+    /* Only reachable through the public API, which does not know about depth/stencil overrides */
+    assert(!depth_stencil);
 
     for (i = 0; i < ARRAY_SIZE(vkd3d_formats); ++i)
     {
@@ -459,22 +510,21 @@ const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
 
 DXGI_FORMAT vkd3d_get_typeless_format(const struct d3d12_device *device, DXGI_FORMAT dxgi_format)
 {
-    const struct vkd3d_format *format = vkd3d_get_format(device, dxgi_format, true);
-    unsigned int i;
+    assert(device);
 
-    if (!format)
+    if ((unsigned int)dxgi_format >= VKD3D_DXGI_FORMAT_COUNT)
         return DXGI_FORMAT_UNKNOWN;
 
-    if (format->type == VKD3D_FORMAT_TYPE_TYPELESS)
-        return dxgi_format;
+    return device->format_table.typeless_formats[dxgi_format];
+}
 
-    for (i = 0; i < ARRAY_SIZE(vkd3d_format_compatibility_info); ++i)
-    {
-        if (vkd3d_format_compatibility_info[i].format == dxgi_format)
-            return vkd3d_format_compatibility_info[i].typeless_format;
-    }
+const VkFormatProperties *vkd3d_get_format_properties(const struct d3d12_device *device,
+        DXGI_FORMAT dxgi_format)
+{
+    if ((unsigned int)dxgi_format >= VKD3D_DXGI_FORMAT_COUNT)
+        return NULL;
 
-    return DXGI_FORMAT_UNKNOWN;
+    return &device->format_table.properties[dxgi_format];
 }
 
 const struct vkd3d_format *vkd3d_find_uint_format(const struct d3d12_device *device, DXGI_FORMAT dxgi_format)
@@ -20,114 +20,241 @@
 
 #include "vkd3d_private.h"
 
-static inline VkDeviceAddress vkd3d_va_map_get_next_address(VkDeviceAddress va)
+static inline unsigned int vkd3d_va_map_get_node_index(VkDeviceAddress va, unsigned int level)
 {
-    return va >> (VKD3D_VA_BLOCK_SIZE_BITS + VKD3D_VA_BLOCK_BITS);
+    return ((va >> VKD3D_VA_BLOCK_SIZE_BITS) >> (VKD3D_VA_LEAF_BITS + VKD3D_VA_NODE_BITS * level)) & VKD3D_VA_NODE_MASK;
 }
 
-static inline VkDeviceAddress vkd3d_va_map_get_block_address(VkDeviceAddress va)
+static inline unsigned int vkd3d_va_map_get_leaf_index(VkDeviceAddress va)
 {
-    return (va >> VKD3D_VA_BLOCK_SIZE_BITS) & VKD3D_VA_BLOCK_MASK;
+    return (va >> VKD3D_VA_BLOCK_SIZE_BITS) & VKD3D_VA_LEAF_MASK;
+}
+
+static inline unsigned int vkd3d_va_map_get_direct_index(VkDeviceAddress va)
+{
+    return (va >> VKD3D_VA_BLOCK_SIZE_BITS) >> VKD3D_VA_LEAF_BITS;
+}
+
+static void vkd3d_va_map_add_memory_usage(struct vkd3d_va_map *va_map, size_t size)
+{
+    VKD3D_REGION_DECL(va_map_memory_usage);
+
+    vkd3d_atomic_uint64_add(&va_map->memory_usage, size, vkd3d_memory_order_relaxed);
+
+    /* Allocated bytes show up as iterations of an empty region in the profiling output */
+    VKD3D_REGION_BEGIN(va_map_memory_usage);
+    VKD3D_REGION_END_ITERATIONS(va_map_memory_usage, size);
 }
 
 static struct vkd3d_va_block *vkd3d_va_map_find_block(struct vkd3d_va_map *va_map, VkDeviceAddress va)
 {
-    VkDeviceAddress next_address = vkd3d_va_map_get_next_address(va);
-    struct vkd3d_va_tree *tree = &va_map->va_tree;
+    struct vkd3d_va_leaf *leaf;
+    unsigned int level;
+    void *next;
 
-    while (next_address && tree)
+    if (va < VKD3D_VA_DIRECT_LIMIT)
     {
-        tree = vkd3d_atomic_ptr_load_explicit(&tree->next[next_address & VKD3D_VA_NEXT_MASK], vkd3d_memory_order_acquire);
-        next_address >>= VKD3D_VA_NEXT_BITS;
+        next = vkd3d_atomic_ptr_load_explicit(&va_map->va_direct[vkd3d_va_map_get_direct_index(va)],
+                vkd3d_memory_order_acquire);
     }
-    
-    if (!tree)
+    else
+    {
+        next = vkd3d_atomic_ptr_load_explicit(&va_map->va_root[(va >> VKD3D_VA_BLOCK_SIZE_BITS) >> VKD3D_VA_ROOT_SHIFT],
+                vkd3d_memory_order_acquire);
+
+        for (level = VKD3D_VA_NODE_LEVELS; level && next; level--)
+        {
+            struct vkd3d_va_node *node = next;
+            next = vkd3d_atomic_ptr_load_explicit(&node->next[vkd3d_va_map_get_node_index(va, level - 1)],
+                    vkd3d_memory_order_acquire);
+        }
+    }
+
+    if (!(leaf = next))
+        return NULL;
+
+    return &leaf->blocks[vkd3d_va_map_get_leaf_index(va)];
+}
+
+static void *vkd3d_va_map_get_child(struct vkd3d_va_map *va_map, void **child_ptr, size_t size)
+{
+    void *child, *orig;
+
+    if ((child = vkd3d_atomic_ptr_load_explicit(child_ptr, vkd3d_memory_order_acquire)))
+        return child;
+
+    if (!(child = vkd3d_calloc(1, size)))
         return NULL;
 
-    return &tree->blocks[vkd3d_va_map_get_block_address(va)];
+    orig = vkd3d_atomic_ptr_compare_exchange(child_ptr, NULL, child, vkd3d_memory_order_release, vkd3d_memory_order_acquire);
+
+    if (orig)
+    {
+        vkd3d_free(child);
+        return orig;
+    }
+
+    vkd3d_va_map_add_memory_usage(va_map, size);
+    return child;
 }
 
 static struct vkd3d_va_block *vkd3d_va_map_get_block(struct vkd3d_va_map *va_map, VkDeviceAddress va)
 {
-    VkDeviceAddress next_address = vkd3d_va_map_get_next_address(va);
-    struct vkd3d_va_tree *tree, **tree_ptr;
-    
-    tree = &va_map->va_tree;
+    struct vkd3d_va_leaf *leaf;
+    struct vkd3d_va_node *node;
+    unsigned int level;
+    void **child_ptr;
 
-    while (next_address)
+    if (va < VKD3D_VA_DIRECT_LIMIT)
+    {
+        child_ptr = &va_map->va_direct[vkd3d_va_map_get_direct_index(va)];
+    }
+    else
     {
-        tree_ptr = &tree->next[next_address & VKD3D_VA_NEXT_MASK];
-        tree = vkd3d_atomic_ptr_load_explicit(tree_ptr, vkd3d_memory_order_acquire);
+        child_ptr = &va_map->va_root[(va >> VKD3D_VA_BLOCK_SIZE_BITS) >> VKD3D_VA_ROOT_SHIFT];
 
-        if (!tree)
+        for (level = VKD3D_VA_NODE_LEVELS; level; level--)
         {
-            void *orig;
-            tree = vkd3d_calloc(1, sizeof(*tree));
-            orig = vkd3d_atomic_ptr_compare_exchange(tree_ptr, NULL, tree, vkd3d_memory_order_release, vkd3d_memory_order_acquire);
+            if (!(node = vkd3d_va_map_get_child(va_map, child_ptr, sizeof(*node))))
+                return NULL;
 
-            if (orig)
-            {
-                vkd3d_free(tree);
-                tree = orig;
-            }
+            child_ptr = &node->next[vkd3d_va_map_get_node_index(va, level - 1)];
         }
-
-        next_address >>= VKD3D_VA_NEXT_BITS;
     }
-    
-    return &tree->blocks[vkd3d_va_map_get_block_address(va)];
+
+    if (!(leaf = vkd3d_va_map_get_child(va_map, child_ptr, sizeof(*leaf))))
+        return NULL;
+
+    return &leaf->blocks[vkd3d_va_map_get_leaf_index(va)];
 }
 
-static void vkd3d_va_map_cleanup_tree(struct vkd3d_va_tree *tree)
+static void vkd3d_va_map_cleanup_node(void *child, unsigned int level)
 {
+    struct vkd3d_va_node *node = child;
     unsigned int i;
 
-    for (i = 0; i < ARRAY_SIZE(tree->next); i++)
+    if (level)
     {
-        if (tree->next[i])
+        for (i = 0; i < ARRAY_SIZE(node->next); i++)
         {
-            vkd3d_va_map_cleanup_tree(tree->next[i]);
-            vkd3d_free(tree->next[i]);
+            if (node->next[i])
+                vkd3d_va_map_cleanup_node(node->next[i], level - 1);
         }
     }
+
+    vkd3d_free(child);
 }
 
-static struct vkd3d_unique_resource *vkd3d_va_map_find_small_entry(struct vkd3d_va_map *va_map,
-        VkDeviceAddress va, size_t *index)
+static struct vkd3d_va_small_entry *vkd3d_va_map_find_small_entry_locked(struct vkd3d_va_map *va_map,
+        VkDeviceAddress va, struct vkd3d_va_small_entry **prev)
 {
-    struct vkd3d_unique_resource *resource = NULL;
-    size_t hi = va_map->small_entries_count;
-    size_t lo = 0;
+    struct vkd3d_va_small_entry *entry = &va_map->small_entries;
+    struct vkd3d_va_small_entry *next;
+    int level;
 
-    while (lo < hi)
+    for (level = VKD3D_VA_SMALL_ENTRY_LEVELS - 1; level >= 0; level--)
     {
-        struct vkd3d_unique_resource *r;
-        size_t i = lo + (hi - lo) / 2;
+        while ((next = entry->next[level]) && va >= next->va + next->size)
+            entry = next;
 
-        r = va_map->small_entries[i];
+        if (prev)
+            prev[level] = entry;
+    }
 
-        if (va < r->va)
-            hi = i;
-        else if (va >= r->va + r->size)
-            lo = i + 1;
-        else
+    next = entry->next[0];
+    return next && va >= next->va ? next : NULL;
+}
+
+static bool vkd3d_va_map_try_find_small_entry(struct vkd3d_va_map *va_map,
+        VkDeviceAddress va, struct vkd3d_unique_resource **resource)
+{
+    struct vkd3d_va_small_entry *entry = &va_map->small_entries;
+    VkDeviceAddress entry_va = 0, next_va = 0;
+    struct vkd3d_va_small_entry *next = NULL;
+    uint32_t seq;
+    int level;
+
+    seq = vkd3d_atomic_uint32_load_explicit(&va_map->small_entries_seq, vkd3d_memory_order_acquire);
+
+    if (seq & 1)
+        return false;
+
+    for (level = VKD3D_VA_SMALL_ENTRY_LEVELS - 1; level >= 0; level--)
+    {
+        while ((next = vkd3d_atomic_ptr_load_explicit(&entry->next[level], vkd3d_memory_order_acquire)))
+        {
+            next_va = vkd3d_atomic_uint64_load_explicit(&next->va, vkd3d_memory_order_acquire);
+
+            /* Addresses strictly increase along each level and 0 is never a valid
+             * VA, so anything else means that we raced with a writer. Bail out
+             * early since we might otherwise follow a cycle of recycled entries. */
+            if (next_va <= entry_va)
+                return false;
+
+            if (va < next_va + vkd3d_atomic_uint64_load_explicit(&next->size, vkd3d_memory_order_acquire))
+                break;
+
+            entry = next;
+            entry_va = next_va;
+        }
+    }
+
+    *resource = next && va >= next_va
+            ? vkd3d_atomic_ptr_load_explicit(&next->resource, vkd3d_memory_order_acquire)
+            : NULL;
+
+    return vkd3d_atomic_uint32_load_explicit(&va_map->small_entries_seq, vkd3d_memory_order_acquire) == seq;
+}
+
+static struct vkd3d_va_small_entry *vkd3d_va_map_alloc_small_entry_locked(struct vkd3d_va_map *va_map)
+{
+    struct vkd3d_va_small_entry *entry, *slab;
+    unsigned int i;
+
+    if (!va_map->free_small_entries)
+    {
+        if (!vkd3d_array_reserve((void**)&va_map->small_entry_slabs, &va_map->small_entry_slabs_size,
+                va_map->small_entry_slabs_count + 1, sizeof(*va_map->small_entry_slabs)))
+            return NULL;
+
+        if (!(slab = vkd3d_calloc(VKD3D_VA_SMALL_ENTRY_SLAB_SIZE, sizeof(*slab))))
+            return NULL;
+
+        va_map->small_entry_slabs[va_map->small_entry_slabs_count++] = slab;
+        vkd3d_va_map_add_memory_usage(va_map, VKD3D_VA_SMALL_ENTRY_SLAB_SIZE * sizeof(*slab));
+
+        for (i = 0; i < VKD3D_VA_SMALL_ENTRY_SLAB_SIZE; i++)
         {
-            lo = hi = i;
-            resource = r;
+            slab[i].next[0] = va_map->free_small_entries;
+            va_map->free_small_entries = &slab[i];
         }
     }
 
-    if (index)
-        *index = lo;
+    entry = va_map->free_small_entries;
+    va_map->free_small_entries = entry->next[0];
+    return entry;
+}
 
-    return resource;
+static unsigned int vkd3d_va_map_get_small_entry_level_count(struct vkd3d_va_map *va_map)
+{
+    uint32_t x = va_map->small_entries_random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    va_map->small_entries_random = x;
+
+    /* Promote entries to the next level with a probability of 1/4 */
+    return min(1 + vkd3d_bitmask_tzcnt32(x) / 2, VKD3D_VA_SMALL_ENTRY_LEVELS);
 }
 
 void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resource *resource)
 {
+    struct vkd3d_va_small_entry *prev[VKD3D_VA_SMALL_ENTRY_LEVELS];
     VkDeviceAddress block_va, min_va, max_va;
+    struct vkd3d_va_small_entry *entry;
+    unsigned int level, level_count;
     struct vkd3d_va_block *block;
-    size_t index;
 
     if (resource->size >= VKD3D_VA_BLOCK_SIZE)
     {
@@ -137,7 +264,11 @@ void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resour
 
         while (block_va < max_va)
         {
-            block = vkd3d_va_map_get_block(va_map, block_va);
+            if (!(block = vkd3d_va_map_get_block(va_map, block_va)))
+            {
+                ERR("Failed to allocate VA map block.\n");
+                return;
+            }
 
             if (block_va < min_va)
             {
@@ -157,16 +288,32 @@ void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resour
     {
         pthread_mutex_lock(&va_map->mutex);
 
-        if (!vkd3d_va_map_find_small_entry(va_map, resource->va, &index))
+        if (!vkd3d_va_map_find_small_entry_locked(va_map, resource->va, prev))
         {
-            vkd3d_array_reserve((void**)&va_map->small_entries, &va_map->small_entries_size,
-                    va_map->small_entries_count + 1, sizeof(*va_map->small_entries));
+            if (!(entry = vkd3d_va_map_alloc_small_entry_locked(va_map)))
+            {
+                ERR("Failed to allocate VA map entry.\n");
+                pthread_mutex_unlock(&va_map->mutex);
+                return;
+            }
+
+            level_count = vkd3d_va_map_get_small_entry_level_count(va_map);
+            vkd3d_atomic_uint32_increment(&va_map->small_entries_seq, vkd3d_memory_order_seq_cst);
+
+            vkd3d_atomic_uint64_store_explicit(&entry->va, resource->va, vkd3d_memory_order_relaxed);
+            vkd3d_atomic_uint64_store_explicit(&entry->size, resource->size, vkd3d_memory_order_relaxed);
+            vkd3d_atomic_ptr_store_explicit(&entry->resource, resource, vkd3d_memory_order_relaxed);
 
-            memmove(&va_map->small_entries[index + 1], &va_map->small_entries[index],
-                    sizeof(*va_map->small_entries) * (va_map->small_entries_count - index));
+            for (level = 0; level < VKD3D_VA_SMALL_ENTRY_LEVELS; level++)
+            {
+                vkd3d_atomic_ptr_store_explicit(&entry->next[level],
+                        level < level_count ? prev[level]->next[level] : NULL, vkd3d_memory_order_relaxed);
+            }
 
-            va_map->small_entries[index] = resource;
-            va_map->small_entries_count += 1;
+            for (level = 0; level < level_count; level++)
+                vkd3d_atomic_ptr_store_explicit(&prev[level]->next[level], entry, vkd3d_memory_order_release);
+
+            vkd3d_atomic_uint32_increment(&va_map->small_entries_seq, vkd3d_memory_order_seq_cst);
         }
 
         pthread_mutex_unlock(&va_map->mutex);
@@ -175,9 +322,11 @@ void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resour
 
 void vkd3d_va_map_remove(struct vkd3d_va_map *va_map, const struct vkd3d_unique_resource *resource)
 {
+    struct vkd3d_va_small_entry *prev[VKD3D_VA_SMALL_ENTRY_LEVELS];
     VkDeviceAddress block_va, min_va, max_va;
+    struct vkd3d_va_small_entry *entry;
     struct vkd3d_va_block *block;
-    size_t index;
+    unsigned int level;
 
     if (resource->size >= VKD3D_VA_BLOCK_SIZE)
     {
@@ -187,7 +336,11 @@ void vkd3d_va_map_remove(struct vkd3d_va_map *va_map, const struct vkd3d_unique_
 
         while (block_va < max_va)
         {
-            block = vkd3d_va_map_get_block(va_map, block_va);
+            if (!(block = vkd3d_va_map_find_block(va_map, block_va)))
+            {
+                block_va += VKD3D_VA_BLOCK_SIZE;
+                continue;
+            }
 
             if (vkd3d_atomic_ptr_load_explicit(&block->l.resource, vkd3d_memory_order_relaxed) == resource)
             {
@@ -207,22 +360,39 @@ void vkd3d_va_map_remove(struct vkd3d_va_map *va_map, const struct vkd3d_unique_
     {
         pthread_mutex_lock(&va_map->mutex);
 
-        if (vkd3d_va_map_find_small_entry(va_map, resource->va, &index) == resource)
+        if ((entry = vkd3d_va_map_find_small_entry_locked(va_map, resource->va, prev)) &&
+                entry->resource == resource)
         {
-            va_map->small_entries_count -= 1;
+            vkd3d_atomic_uint32_increment(&va_map->small_entries_seq, vkd3d_memory_order_seq_cst);
 
-            memmove(&va_map->small_entries[index], &va_map->small_entries[index + 1],
-                    sizeof(*va_map->small_entries) * (va_map->small_entries_count - index));
+            for (level = 0; level < VKD3D_VA_SMALL_ENTRY_LEVELS; level++)
+            {
+                if (prev[level]->next[level] == entry)
+                {
+                    vkd3d_atomic_ptr_store_explicit(&prev[level]->next[level],
+                            entry->next[level], vkd3d_memory_order_relaxed);
+                }
+            }
+
+            /* Readers may still be looking at the entry, so only recycle it */
+            vkd3d_atomic_ptr_store_explicit(&entry->next[0], va_map->free_small_entries, vkd3d_memory_order_relaxed);
+            va_map->free_small_entries = entry;
+
+            vkd3d_atomic_uint32_increment(&va_map->small_entries_seq, vkd3d_memory_order_seq_cst);
         }
 
         pthread_mutex_unlock(&va_map->mutex);
     }
 }
 
+#define VKD3D_VA_SMALL_ENTRY_MAX_RETRIES (4)
+
 static struct vkd3d_unique_resource *vkd3d_va_map_deref_mutable(struct vkd3d_va_map *va_map, VkDeviceAddress va)
 {
     struct vkd3d_va_block *block = vkd3d_va_map_find_block(va_map, va);
     struct vkd3d_unique_resource *resource = NULL;
+    struct vkd3d_va_small_entry *entry;
+    unsigned int i;
 
     if (block)
     {
@@ -234,8 +404,18 @@ static struct vkd3d_unique_resource *vkd3d_va_map_deref_mutable(struct vkd3d_va_
 
     if (!resource)
     {
+        /* Only fall back to locking if we keep racing with writers */
+        for (i = 0; i < VKD3D_VA_SMALL_ENTRY_MAX_RETRIES; i++)
+        {
+            if (vkd3d_va_map_try_find_small_entry(va_map, va, &resource))
+                return resource;
+
+            vkd3d_pause();
+        }
+
         pthread_mutex_lock(&va_map->mutex);
-        resource = vkd3d_va_map_find_small_entry(va_map, va, NULL);
+        if ((entry = vkd3d_va_map_find_small_entry_locked(va_map, va, NULL)))
+            resource = (struct vkd3d_unique_resource *)entry->resource;
         pthread_mutex_unlock(&va_map->mutex);
     }
 
@@ -428,15 +608,36 @@ void vkd3d_va_map_init(struct vkd3d_va_map *va_map)
 
     /* Make sure we never return 0 as a valid VA */
     va_map->va_allocator.next_va = VKD3D_VA_BLOCK_SIZE;
+
+    /* Any non-zero seed works for the xorshift generator */
+    va_map->small_entries_random = 0x9e3779b9u;
 }
 
 void vkd3d_va_map_cleanup(struct vkd3d_va_map *va_map)
 {
-    vkd3d_va_map_cleanup_tree(&va_map->va_tree);
+    size_t i;
+
+    TRACE("VA map used %"PRIu64" bytes.\n", vkd3d_va_map_get_memory_usage(va_map));
+
+    for (i = 0; i < ARRAY_SIZE(va_map->va_direct); i++)
+        vkd3d_free(va_map->va_direct[i]);
+
+    for (i = 0; i < ARRAY_SIZE(va_map->va_root); i++)
+    {
+        if (va_map->va_root[i])
+            vkd3d_va_map_cleanup_node(va_map->va_root[i], VKD3D_VA_NODE_LEVELS);
+    }
+
+    for (i = 0; i < va_map->small_entry_slabs_count; i++)
+        vkd3d_free(va_map->small_entry_slabs[i]);
 
     pthread_mutex_destroy(&va_map->va_allocator.mutex);
     pthread_mutex_destroy(&va_map->mutex);
     vkd3d_free(va_map->va_allocator.free_ranges);
-    vkd3d_free(va_map->small_entries);
+    vkd3d_free(va_map->small_entry_slabs);
 }
 
+uint64_t vkd3d_va_map_get_memory_usage(struct vkd3d_va_map *va_map)
+{
+    return vkd3d_atomic_uint64_load_explicit(&va_map->memory_usage, vkd3d_memory_order_relaxed);
+}
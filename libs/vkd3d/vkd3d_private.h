@@ -65,6 +65,8 @@ struct d3d12_resource;
 
 struct vkd3d_bindless_set_info;
 struct vkd3d_dynamic_state;
+struct vkd3d_view;
+struct vkd3d_cached_framebuffer;
 
 struct vkd3d_vk_global_procs
 {
@@ -213,6 +215,12 @@ struct vkd3d_fence_worker
     struct vkd3d_waiting_fence *enqueued_fences;
     size_t enqueued_fences_size;
 
+    /* Host-signalled timeline semaphore which lets producers wake up
+     * the worker while it is blocked in vkWaitSemaphores. */
+    VkSemaphore wake_semaphore;
+    uint64_t wake_value;
+    bool waiting_on_gpu;
+
     struct d3d12_device *device;
 };
 
@@ -225,13 +233,26 @@ HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
 #define VKD3D_VA_BLOCK_SIZE (1ull << VKD3D_VA_BLOCK_SIZE_BITS)
 #define VKD3D_VA_LO_MASK (VKD3D_VA_BLOCK_SIZE - 1)
 
-#define VKD3D_VA_BLOCK_BITS (20)
-#define VKD3D_VA_BLOCK_COUNT (1ull << VKD3D_VA_BLOCK_BITS)
-#define VKD3D_VA_BLOCK_MASK (VKD3D_VA_BLOCK_COUNT - 1)
+/* Blocks are stored in 4 KiB leaves, which are only allocated once a VA
+ * range is used. Leaves for the lowest 1 TiB of VA space are referenced
+ * directly from the VA map so that lookups only chase a single pointer,
+ * higher addresses go through a radix table with 32 KiB interior nodes. */
+#define VKD3D_VA_LEAF_BITS (7)
+#define VKD3D_VA_LEAF_COUNT (1ull << VKD3D_VA_LEAF_BITS)
+#define VKD3D_VA_LEAF_MASK (VKD3D_VA_LEAF_COUNT - 1)
+
+#define VKD3D_VA_DIRECT_BITS (13)
+#define VKD3D_VA_DIRECT_COUNT (1ull << VKD3D_VA_DIRECT_BITS)
+#define VKD3D_VA_DIRECT_LIMIT (1ull << (VKD3D_VA_BLOCK_SIZE_BITS + VKD3D_VA_LEAF_BITS + VKD3D_VA_DIRECT_BITS))
+
+#define VKD3D_VA_NODE_BITS (12)
+#define VKD3D_VA_NODE_COUNT (1ull << VKD3D_VA_NODE_BITS)
+#define VKD3D_VA_NODE_MASK (VKD3D_VA_NODE_COUNT - 1)
+#define VKD3D_VA_NODE_LEVELS (2)
 
-#define VKD3D_VA_NEXT_BITS (12)
-#define VKD3D_VA_NEXT_COUNT (1ull << VKD3D_VA_NEXT_BITS)
-#define VKD3D_VA_NEXT_MASK (VKD3D_VA_NEXT_COUNT - 1)
+#define VKD3D_VA_ROOT_SHIFT (VKD3D_VA_LEAF_BITS + VKD3D_VA_NODE_BITS * VKD3D_VA_NODE_LEVELS)
+#define VKD3D_VA_ROOT_BITS (64 - VKD3D_VA_BLOCK_SIZE_BITS - VKD3D_VA_ROOT_SHIFT)
+#define VKD3D_VA_ROOT_COUNT (1ull << VKD3D_VA_ROOT_BITS)
 
 struct vkd3d_unique_resource;
 
@@ -247,10 +268,27 @@ struct vkd3d_va_block
     struct vkd3d_va_entry r;
 };
 
-struct vkd3d_va_tree
+struct vkd3d_va_leaf
+{
+    struct vkd3d_va_block blocks[VKD3D_VA_LEAF_COUNT];
+};
+
+/* Children are either nodes or, on the last level, leaves */
+struct vkd3d_va_node
+{
+    void *next[VKD3D_VA_NODE_COUNT];
+};
+
+/* Resources smaller than a VA block are kept in a skip list. */
+#define VKD3D_VA_SMALL_ENTRY_LEVELS (12)
+#define VKD3D_VA_SMALL_ENTRY_SLAB_SIZE (256)
+
+struct vkd3d_va_small_entry
 {
-    struct vkd3d_va_block blocks[VKD3D_VA_BLOCK_COUNT];
-    struct vkd3d_va_tree *next[VKD3D_VA_NEXT_COUNT];
+    DECLSPEC_ALIGN(8) VkDeviceAddress va;
+    DECLSPEC_ALIGN(8) VkDeviceSize size;
+    const struct vkd3d_unique_resource *resource;
+    struct vkd3d_va_small_entry *next[VKD3D_VA_SMALL_ENTRY_LEVELS];
 };
 
 struct vkd3d_va_range
@@ -272,14 +310,27 @@ struct vkd3d_va_allocator
 
 struct vkd3d_va_map
 {
-    struct vkd3d_va_tree va_tree;
+    void *va_direct[VKD3D_VA_DIRECT_COUNT];
+    void *va_root[VKD3D_VA_ROOT_COUNT];
     struct vkd3d_va_allocator va_allocator;
 
+    /* Bytes allocated for the radix table and small entries */
+    uint64_t memory_usage;
+
+    /* Writers to the small entry list hold the mutex and increment the
+     * sequence number before and after modifying it, readers search it
+     * without locking and retry if the sequence number changed. Entries
+     * are recycled but never freed, so readers never touch freed memory. */
     pthread_mutex_t mutex;
+    uint32_t small_entries_seq;
+    uint32_t small_entries_random;
+
+    struct vkd3d_va_small_entry small_entries;
+    struct vkd3d_va_small_entry *free_small_entries;
 
-    struct vkd3d_unique_resource **small_entries;
-    size_t small_entries_size;
-    size_t small_entries_count;
+    struct vkd3d_va_small_entry **small_entry_slabs;
+    size_t small_entry_slabs_size;
+    size_t small_entry_slabs_count;
 };
 
 void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resource *resource);
@@ -292,6 +343,7 @@ VkDeviceAddress vkd3d_va_map_alloc_fake_va(struct vkd3d_va_map *va_map, VkDevice
 void vkd3d_va_map_free_fake_va(struct vkd3d_va_map *va_map, VkDeviceAddress va, VkDeviceSize size);
 void vkd3d_va_map_init(struct vkd3d_va_map *va_map);
 void vkd3d_va_map_cleanup(struct vkd3d_va_map *va_map);
+uint64_t vkd3d_va_map_get_memory_usage(struct vkd3d_va_map *va_map);
 
 struct vkd3d_gpu_va_allocation
 {
@@ -326,13 +378,11 @@ struct vkd3d_render_pass_key
     VkFormat vk_formats[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
 };
 
-struct vkd3d_render_pass_entry;
-
+/* Lookups are lock-free, the mutex only serializes creating render passes */
 struct vkd3d_render_pass_cache
 {
-    struct vkd3d_render_pass_entry *render_passes;
-    size_t render_pass_count;
-    size_t render_passes_size;
+    pthread_mutex_t mutex;
+    struct concurrent_hash_map map;
 };
 
 void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
@@ -340,7 +390,37 @@ void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
 HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device, const struct vkd3d_render_pass_key *key,
         VkRenderPass *vk_render_pass);
-void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache);
+HRESULT vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache);
+
+struct vkd3d_framebuffer_key
+{
+    VkRenderPass vk_render_pass;
+    VkExtent3D extent;
+    uint32_t view_count;
+    /* View cookies are never reused, unlike Vulkan handles, so keys of evicted framebuffers never match again */
+    uint64_t view_cookies[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+};
+
+/* Framebuffers are shared between command lists and live until one of
+ * their attachments is destroyed. Lookups are lock-free. Evicted entries
+ * stay in the hash map with a null framebuffer until enough of them have
+ * accumulated, at which point the map is compacted. */
+struct vkd3d_framebuffer_cache
+{
+    pthread_mutex_t mutex;
+    struct concurrent_hash_map map;
+    uint32_t dead_count;
+    uint32_t reader_count; /* atomic, number of lock-free lookups in progress */
+};
+
+void vkd3d_framebuffer_cache_cleanup(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device);
+void vkd3d_framebuffer_cache_evict_view(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device, struct vkd3d_view *view);
+HRESULT vkd3d_framebuffer_cache_find(struct vkd3d_framebuffer_cache *cache,
+        struct d3d12_device *device, VkRenderPass vk_render_pass, uint32_t view_count,
+        struct vkd3d_view * const *views, const VkExtent3D *extent, VkFramebuffer *vk_framebuffer);
+HRESULT vkd3d_framebuffer_cache_init(struct vkd3d_framebuffer_cache *cache);
 
 struct vkd3d_private_store
 {
@@ -569,7 +649,8 @@ enum vkd3d_allocation_flag
     VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH = (1u << 3),
 };
 
-#define VKD3D_MEMORY_CHUNK_SIZE (VKD3D_VA_BLOCK_SIZE * 16)
+#define VKD3D_MEMORY_CHUNK_SIZE_BITS (VKD3D_VA_BLOCK_SIZE_BITS + 4)
+#define VKD3D_MEMORY_CHUNK_SIZE (1ull << VKD3D_MEMORY_CHUNK_SIZE_BITS)
 
 struct vkd3d_memory_chunk;
 
@@ -631,6 +712,7 @@ struct vkd3d_memory_allocation
     uint64_t clear_semaphore_value;
 
     struct vkd3d_memory_chunk *chunk;
+    uint32_t chunk_block;
 };
 
 static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation *dst,
@@ -645,27 +727,102 @@ static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation
         dst->cpu_address = void_ptr_offset(dst->cpu_address, offset);
 }
 
-struct vkd3d_memory_free_range
+/* Chunks are managed with a two-level segregated fit allocator. Free blocks
+ * are binned by the log2 of their size and then linearly subdivided into
+ * VKD3D_MEMORY_CHUNK_SL_COUNT size classes, so that finding a suitable block
+ * or coalescing adjacent blocks on free is O(1) regardless of fragmentation. */
+#define VKD3D_MEMORY_CHUNK_GRANULARITY_BITS (8)
+#define VKD3D_MEMORY_CHUNK_GRANULARITY (1ull << VKD3D_MEMORY_CHUNK_GRANULARITY_BITS)
+#define VKD3D_MEMORY_CHUNK_SL_BITS (4)
+#define VKD3D_MEMORY_CHUNK_SL_COUNT (1u << VKD3D_MEMORY_CHUNK_SL_BITS)
+#define VKD3D_MEMORY_CHUNK_FL_COUNT (VKD3D_MEMORY_CHUNK_SIZE_BITS - VKD3D_MEMORY_CHUNK_GRANULARITY_BITS - VKD3D_MEMORY_CHUNK_SL_BITS + 2)
+#define VKD3D_MEMORY_CHUNK_BLOCK_NONE (~0u)
+
+/* Chunks are cleared once when they are created, after which we track
+ * which pages have ever been handed out. Suballocations only need to
+ * clear the parts of their range that overlap such dirty pages. */
+#define VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS (16)
+#define VKD3D_MEMORY_CHUNK_PAGE_COUNT (1u << (VKD3D_MEMORY_CHUNK_SIZE_BITS - VKD3D_MEMORY_CHUNK_PAGE_SIZE_BITS))
+
+struct vkd3d_memory_chunk_block
 {
     VkDeviceSize offset;
     VkDeviceSize length;
+    /* Neighbouring blocks in address order */
+    uint32_t prev_phys;
+    uint32_t next_phys;
+    /* Links in the free list for the size class, or
+     * the list of unused block structs if not in use */
+    uint32_t prev_free;
+    uint32_t next_free;
+    bool is_free;
 };
 
 struct vkd3d_memory_chunk
 {
     struct vkd3d_memory_allocation allocation;
-    struct vkd3d_memory_free_range *free_ranges;
-    size_t free_ranges_size;
-    size_t free_ranges_count;
+    struct vkd3d_memory_chunk_block *blocks;
+    size_t blocks_size;
+    size_t blocks_count;
+    uint32_t unused_block;
+    VkDeviceSize free_size;
+
+    uint32_t fl_mask;
+    uint32_t sl_masks[VKD3D_MEMORY_CHUNK_FL_COUNT];
+    uint32_t free_lists[VKD3D_MEMORY_CHUNK_FL_COUNT][VKD3D_MEMORY_CHUNK_SL_COUNT];
+
+    /* Protected by the clear queue lock */
+    uint64_t dirty_pages[VKD3D_MEMORY_CHUNK_PAGE_COUNT / 64];
+};
+
+/* Chunks that share a heap type, heap flags and memory type are
+ * interchangeable, so they are kept together in one bucket. */
+struct vkd3d_memory_chunk_bucket
+{
+    D3D12_HEAP_TYPE heap_type;
+    D3D12_HEAP_FLAGS heap_flags;
+    uint32_t vk_memory_type;
+
+    struct vkd3d_memory_chunk **chunks;
+    size_t chunks_size;
+    size_t chunks_count;
 };
 
 #define VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT (16u)
 
+struct vkd3d_memory_clear_range
+{
+    const struct vkd3d_memory_allocation *allocation;
+    VkBuffer vk_buffer;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+struct vkd3d_memory_clear_command_buffer
+{
+    VkCommandBuffer vk_command_buffer;
+    uint64_t signal_value;
+};
+
+/* Memory whose clear may still be executing on the GPU when it gets freed.
+ * The clear worker releases it once the clear timeline reaches wait_value. */
+struct vkd3d_memory_deferred_free
+{
+    uint64_t wait_value;
+    struct vkd3d_memory_chunk *chunk;
+    struct vkd3d_memory_allocation allocation;
+};
+
+/* The clear_semaphore_value of an allocation acts as a token for its clear,
+ * which is complete once the timeline semaphore has reached that value. */
 struct vkd3d_memory_clear_queue
 {
     pthread_mutex_t mutex;
+    pthread_cond_t cond;
 
-    VkCommandBuffer vk_command_buffers[VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT];
+    struct vkd3d_memory_clear_command_buffer *command_buffers;
+    size_t command_buffers_size;
+    size_t command_buffers_count;
     VkCommandPool vk_command_pool;
     VkSemaphore vk_semaphore;
 
@@ -675,18 +832,70 @@ struct vkd3d_memory_clear_queue
     VkDeviceSize num_bytes_pending;
     uint32_t command_buffer_index;
 
-    struct vkd3d_memory_allocation **allocations;
-    size_t allocations_size;
-    size_t allocations_count;
+    struct vkd3d_memory_clear_range *ranges;
+    size_t ranges_size;
+    size_t ranges_count;
+
+    struct vkd3d_memory_deferred_free *deferred_frees;
+    size_t deferred_frees_size;
+    size_t deferred_frees_count;
+
+    union vkd3d_thread_handle worker_thread;
+    struct d3d12_device *device;
+    bool worker_running;
+    bool should_exit;
+
+    /* Statistics for suballocated memory */
+    uint64_t num_bytes_cleared;
+    uint64_t num_bytes_skipped;
+};
+
+/* Suballocations which are a multiple of 64 KiB are cached in small
+ * per-thread magazines, so that threads which create and destroy many
+ * resources rarely have to take the global allocator lock. Threads are
+ * mapped to a fixed number of shards by their thread ID. Magazines are
+ * drained before new chunks are allocated, and magazines which have not
+ * been used for a trim interval of locked allocator operations are
+ * returned to their chunks. */
+#define VKD3D_MEMORY_MAGAZINE_GRANULARITY (64ull << 10)
+#define VKD3D_MEMORY_MAGAZINE_SIZE (8u)
+#define VKD3D_MEMORY_MAGAZINE_REFILL_COUNT (VKD3D_MEMORY_MAGAZINE_SIZE / 2)
+#define VKD3D_MEMORY_MAGAZINE_SHARD_COUNT (8u)
+#define VKD3D_MEMORY_MAGAZINE_SHARD_MAX_BYTES (4ull << 20)
+#define VKD3D_MEMORY_MAGAZINE_TRIM_INTERVAL (256u)
+
+struct vkd3d_memory_magazine
+{
+    D3D12_HEAP_TYPE heap_type;
+    D3D12_HEAP_FLAGS heap_flags;
+    uint32_t vk_memory_type;
+    VkDeviceSize size;
+
+    struct vkd3d_memory_allocation allocations[VKD3D_MEMORY_MAGAZINE_SIZE];
+    uint32_t allocation_count;
+    bool used;
+};
+
+struct vkd3d_memory_magazine_shard
+{
+    spinlock_t lock;
+    VkDeviceSize cached_bytes;
+
+    struct vkd3d_memory_magazine *magazines;
+    size_t magazines_size;
+    size_t magazines_count;
 };
 
 struct vkd3d_memory_allocator
 {
     pthread_mutex_t mutex;
 
-    struct vkd3d_memory_chunk **chunks;
-    size_t chunks_size;
-    size_t chunks_count;
+    struct vkd3d_memory_magazine_shard magazine_shards[VKD3D_MEMORY_MAGAZINE_SHARD_COUNT];
+    uint32_t magazine_trim_counter;
+
+    struct vkd3d_memory_chunk_bucket *chunk_buckets;
+    size_t chunk_buckets_size;
+    size_t chunk_buckets_count;
 
     struct vkd3d_va_map va_map;
 
@@ -773,8 +982,9 @@ struct d3d12_sparse_info
 
 struct vkd3d_view_map
 {
+    /* Serializes inserts, lookups do not take the lock */
     spinlock_t spinlock;
-    struct hash_map map;
+    struct concurrent_hash_map map;
 #ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     uint64_t resource_cookie;
 #endif
@@ -873,6 +1083,32 @@ HRESULT vkd3d_create_buffer(struct d3d12_device *device,
 HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info);
 
+struct vkd3d_memory_requirements_key
+{
+    UINT64 width;
+    D3D12_RESOURCE_DIMENSION dimension;
+    DXGI_FORMAT format;
+    UINT height;
+    UINT sample_count;
+    UINT sample_quality;
+    D3D12_TEXTURE_LAYOUT layout;
+    D3D12_RESOURCE_FLAGS flags;
+    UINT16 depth_or_array_size;
+    UINT16 mip_levels;
+};
+
+/* Memory requirements of images with a given description, as
+ * queried for GetResourceAllocationInfo. Lookups are lock-free,
+ * the spinlock only serializes inserts. */
+struct vkd3d_memory_requirements_cache
+{
+    spinlock_t spinlock;
+    struct concurrent_hash_map map;
+};
+
+void vkd3d_memory_requirements_cache_init(struct vkd3d_memory_requirements_cache *cache);
+void vkd3d_memory_requirements_cache_cleanup(struct vkd3d_memory_requirements_cache *cache);
+
 enum vkd3d_view_type
 {
     VKD3D_VIEW_TYPE_BUFFER,
@@ -886,6 +1122,12 @@ struct vkd3d_view
     LONG refcount;
     enum vkd3d_view_type type;
     uint64_t cookie;
+    uint32_t framebuffer_refs; /* atomic, number of cached framebuffers using this view */
+
+    /* Cached framebuffers using this view, protected by the framebuffer cache mutex */
+    struct vkd3d_cached_framebuffer **framebuffers;
+    size_t framebuffers_size;
+    size_t framebuffers_count;
 
     union
     {
@@ -999,8 +1241,24 @@ static inline struct d3d12_desc *d3d12_desc_from_gpu_handle(D3D12_GPU_DESCRIPTOR
     return (struct d3d12_desc *)(intptr_t)gpu_handle.ptr;
 }
 
-void d3d12_desc_copy(struct d3d12_desc *dst, struct d3d12_desc *src,
-        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device);
+#define VKD3D_DESC_COPY_BATCH_SIZE 256
+
+/* Collects the Vulkan descriptor copies of an entire CopyDescriptors call,
+ * so that they can be submitted with a single vkUpdateDescriptorSets. */
+struct d3d12_desc_copy_batch
+{
+    VkCopyDescriptorSet vk_copies[VKD3D_DESC_COPY_BATCH_SIZE];
+    uint32_t copy_count;
+};
+
+static inline void d3d12_desc_copy_batch_init(struct d3d12_desc_copy_batch *batch)
+{
+    batch->copy_count = 0;
+}
+
+void d3d12_desc_copy_batch_flush(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device);
+void d3d12_desc_copy(struct d3d12_desc *dst, struct d3d12_desc *src, unsigned int count,
+        D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_desc_copy_batch *batch, struct d3d12_device *device);
 void d3d12_desc_create_cbv(struct d3d12_desc *descriptor,
         struct d3d12_device *device, const D3D12_CONSTANT_BUFFER_VIEW_DESC *desc);
 void d3d12_desc_create_srv(struct d3d12_desc *descriptor,
@@ -1156,6 +1414,7 @@ enum vkd3d_root_signature_flag
     VKD3D_ROOT_SIGNATURE_USE_RAW_VA_AUX_BUFFER      = 0x00000004u,
     VKD3D_ROOT_SIGNATURE_USE_SSBO_OFFSET_BUFFER     = 0x00000008u,
     VKD3D_ROOT_SIGNATURE_USE_TYPED_OFFSET_BUFFER    = 0x00000010u,
+    VKD3D_ROOT_SIGNATURE_USE_ROOT_PARAMETER_BUFFER  = 0x00000020u,
 };
 
 /* ID3D12RootSignature */
@@ -1327,7 +1586,10 @@ struct d3d12_graphics_pipeline_state
 
     VkPipelineLayout pipeline_layout;
     VkPipeline pipeline[VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT];
-    struct list compiled_fallback_pipelines;
+
+    /* Lookups are lock-free, the lock only serializes insertion of new variants. */
+    struct vkd3d_compiled_pipeline_table *compiled_fallback_pipelines;
+    spinlock_t compiled_fallback_lock;
 
     bool xfb_enabled;
 };
@@ -1439,9 +1701,47 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
 VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
         const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format,
         VkRenderPass *vk_render_pass, uint32_t *dynamic_state_flags, uint32_t variant_flags);
+void d3d12_pipeline_state_prefetch_pipeline(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state, VkFormat dsv_format, uint32_t variant_flags);
 VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_state *state,
         const struct vkd3d_pipeline_key *key, VkFormat dsv_format, VkPipelineCache vk_cache,
         VkRenderPass *vk_render_pass, uint32_t *dynamic_state_flags, uint32_t variant_flags);
+
+#define VKD3D_PIPELINE_COMPILE_MAX_THREAD_COUNT 8
+
+struct vkd3d_pipeline_compile_pool;
+struct vkd3d_pipeline_compile_job;
+
+struct vkd3d_pipeline_compile_worker
+{
+    struct vkd3d_pipeline_compile_pool *pool;
+    union vkd3d_thread_handle thread;
+    struct d3d12_pipeline_state *active_state;
+};
+
+/* Compiles fallback pipeline variants in the background, see VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE. */
+struct vkd3d_pipeline_compile_pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_cond_t idle_cond;
+    bool should_exit;
+
+    /* Ring buffer of queued jobs */
+    struct vkd3d_pipeline_compile_job *jobs;
+    size_t jobs_size;
+    size_t job_head;
+    size_t job_count;
+
+    struct vkd3d_pipeline_compile_worker workers[VKD3D_PIPELINE_COMPILE_MAX_THREAD_COUNT];
+    unsigned int worker_count;
+    struct d3d12_device *device;
+};
+
+HRESULT vkd3d_pipeline_compile_pool_init(struct vkd3d_pipeline_compile_pool *pool, struct d3d12_device *device);
+void vkd3d_pipeline_compile_pool_cleanup(struct vkd3d_pipeline_compile_pool *pool, struct d3d12_device *device);
+void vkd3d_pipeline_compile_pool_cancel(struct vkd3d_pipeline_compile_pool *pool,
+        struct d3d12_pipeline_state *state);
 struct d3d12_pipeline_state *unsafe_impl_from_ID3D12PipelineState(ID3D12PipelineState *iface);
 
 /* ID3D12PipelineLibrary */
@@ -1493,6 +1793,9 @@ enum vkd3d_descriptor_pool_types
 
 #define VKD3D_SCRATCH_BUFFER_SIZE (1ull << 20)
 #define VKD3D_SCRATCH_BUFFER_COUNT (32u)
+#define VKD3D_SCRATCH_POOL_CLASS_COUNT (7u)
+#define VKD3D_SCRATCH_POOL_DECAY_INTERVAL (256u)
+#define VKD3D_SCRATCH_ALLOCATOR_CACHE_COUNT (4u)
 
 struct vkd3d_scratch_buffer
 {
@@ -1500,6 +1803,37 @@ struct vkd3d_scratch_buffer
     VkDeviceSize offset;
 };
 
+/* Size class n holds buffers of VKD3D_SCRATCH_BUFFER_SIZE << n bytes. The
+ * number of cached buffers is bounded by the recent peak usage, which
+ * decays over time so that bursts do not pin memory forever. */
+struct vkd3d_scratch_pool_class
+{
+    struct vkd3d_scratch_buffer buffers[VKD3D_SCRATCH_BUFFER_COUNT];
+    uint32_t buffer_count;
+    uint32_t in_use_count;
+    uint32_t window_peak;
+    uint32_t high_water;
+};
+
+struct vkd3d_scratch_pool
+{
+    struct vkd3d_scratch_pool_class classes[VKD3D_SCRATCH_POOL_CLASS_COUNT];
+    uint32_t return_count;
+};
+
+#define VKD3D_ROOT_PARAMETER_BUFFER_SIZE (64ull << 10)
+#define VKD3D_ROOT_PARAMETER_BUFFER_RANGE (D3D12_MAX_ROOT_COST * sizeof(uint32_t))
+
+/* Upload buffer that root parameters are streamed into for root signatures
+ * which read them from a dynamic uniform buffer. The descriptor set covers
+ * the whole buffer and individual draws only change the dynamic offset. */
+struct vkd3d_root_parameter_buffer
+{
+    struct vkd3d_memory_allocation allocation;
+    VkDescriptorSet vk_descriptor_set;
+    VkDeviceSize offset;
+};
+
 #define VKD3D_QUERY_TYPE_INDEX_OCCLUSION (0u)
 #define VKD3D_QUERY_TYPE_INDEX_PIPELINE_STATISTICS (1u)
 #define VKD3D_QUERY_TYPE_INDEX_TRANSFORM_FEEDBACK (2u)
@@ -1553,6 +1887,17 @@ struct d3d12_command_allocator
     size_t scratch_buffers_size;
     size_t scratch_buffer_count;
 
+    /* Scratch buffers kept across resets to avoid going through the device */
+    struct vkd3d_scratch_buffer cached_scratch_buffers[VKD3D_SCRATCH_ALLOCATOR_CACHE_COUNT];
+    size_t cached_scratch_buffer_count;
+
+    /* Root parameter buffers are kept across resets, buffers up to
+     * root_parameter_buffer_index are in use by recorded commands. */
+    struct vkd3d_root_parameter_buffer *root_parameter_buffers;
+    size_t root_parameter_buffers_size;
+    size_t root_parameter_buffer_count;
+    size_t root_parameter_buffer_index;
+
     struct vkd3d_query_pool *query_pools;
     size_t query_pools_size;
     size_t query_pool_count;
@@ -1709,6 +2054,19 @@ struct vkd3d_query_range
     uint32_t flags;
 };
 
+/* Global memory barrier accumulated by ResourceBarrier, flushed right
+ * before the next command that records actual work. */
+struct vkd3d_deferred_barrier
+{
+    VkPipelineStageFlags src_stage_mask;
+    VkPipelineStageFlags dst_stage_mask;
+    VkAccessFlags src_access_mask;
+    VkAccessFlags dst_access_mask;
+
+    uint32_t issued_count;
+    uint32_t elided_count;
+};
+
 struct d3d12_state_object;
 
 struct d3d12_command_list
@@ -1770,9 +2128,12 @@ struct d3d12_command_list
     VkBuffer so_counter_buffers[D3D12_SO_BUFFER_SLOT_COUNT];
     VkDeviceSize so_counter_buffer_offsets[D3D12_SO_BUFFER_SLOT_COUNT];
 
+    struct vkd3d_deferred_barrier deferred_barrier;
+
     struct vkd3d_initial_transition *init_transitions;
     size_t init_transitions_size;
     size_t init_transitions_count;
+    struct hash_map init_transition_map;
 
     struct vkd3d_query_range *query_ranges;
     size_t query_ranges_size;
@@ -1991,13 +2352,17 @@ struct d3d12_command_queue
     pthread_cond_t queue_cond;
     pthread_t submission_thread;
 
+    /* Ring buffer of pending submissions, size is always a power of two. */
     struct d3d12_command_queue_submission *submissions;
+    size_t submissions_head;
     size_t submissions_count;
     size_t submissions_size;
     uint64_t drain_count;
     uint64_t queue_drain_count;
 
-    struct vkd3d_fence_worker fence_worker;
+    /* Points either to queue_fence_worker or to the device's shared fence worker. */
+    struct vkd3d_fence_worker *fence_worker;
+    struct vkd3d_fence_worker queue_fence_worker;
     struct vkd3d_private_store private_store;
 
 #ifdef VKD3D_BUILD_STANDALONE_D3D12
@@ -2157,6 +2522,18 @@ static inline VkDescriptorType vkd3d_bindless_state_get_cbv_descriptor_type(cons
             : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 }
 
+#define VKD3D_DXGI_FORMAT_COUNT (DXGI_FORMAT_B4G4R4A4_UNORM + 1)
+
+/* Lookup tables indexed by DXGI_FORMAT, built once at device creation. */
+struct vkd3d_format_table
+{
+    const struct vkd3d_format *formats[VKD3D_DXGI_FORMAT_COUNT];
+    const struct vkd3d_format *depth_stencil_formats[VKD3D_DXGI_FORMAT_COUNT];
+    DXGI_FORMAT typeless_formats[VKD3D_DXGI_FORMAT_COUNT];
+    /* Properties of the Vulkan format that format support queries resolve to */
+    VkFormatProperties properties[VKD3D_DXGI_FORMAT_COUNT];
+};
+
 struct vkd3d_format_compatibility_list
 {
     DXGI_FORMAT typeless_format;
@@ -2571,6 +2948,8 @@ struct d3d12_device
 
     pthread_mutex_t mutex;
     struct vkd3d_render_pass_cache render_pass_cache;
+    struct vkd3d_framebuffer_cache framebuffer_cache;
+    struct vkd3d_memory_requirements_cache memory_requirements_cache;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
 
@@ -2591,9 +2970,10 @@ struct d3d12_device
     struct d3d12_caps d3d12_caps;
 
     struct vkd3d_memory_allocator memory_allocator;
+    struct vkd3d_fence_worker shared_fence_worker;
+    struct vkd3d_pipeline_compile_pool pipeline_compile_pool;
 
-    struct vkd3d_scratch_buffer scratch_buffers[VKD3D_SCRATCH_BUFFER_COUNT];
-    size_t scratch_buffer_count;
+    struct vkd3d_scratch_pool scratch_pool;
 
     struct vkd3d_query_pool query_pools[VKD3D_VIRTUAL_QUERY_POOL_COUNT];
     size_t query_pool_count;
@@ -2608,6 +2988,7 @@ struct d3d12_device
     const struct vkd3d_format *depth_stencil_formats;
     unsigned int format_compatibility_list_count;
     const struct vkd3d_format_compatibility_list *format_compatibility_lists;
+    struct vkd3d_format_table format_table;
     struct vkd3d_bindless_state bindless_state;
     struct vkd3d_memory_info memory_info;
     struct vkd3d_meta_ops meta_ops;
@@ -2810,6 +3191,8 @@ void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *sr
 const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format, bool depth_stencil);
 DXGI_FORMAT vkd3d_get_typeless_format(const struct d3d12_device *device, DXGI_FORMAT dxgi_format);
+const VkFormatProperties *vkd3d_get_format_properties(const struct d3d12_device *device,
+        DXGI_FORMAT dxgi_format);
 const struct vkd3d_format *vkd3d_find_uint_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format);
 
@@ -78,6 +78,24 @@ static void copy_descriptor_heap(ID3D12Device *device, ID3D12DescriptorHeap *gpu
             D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 }
 
+static void copy_descriptor_heap_chunked(ID3D12Device *device, ID3D12DescriptorHeap *gpu_heap,
+        ID3D12DescriptorHeap *cpu_heap, unsigned int count, unsigned int chunk_size)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE dst, src;
+    UINT stride, i;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    dst = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(gpu_heap);
+    src = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cpu_heap);
+
+    for (i = 0; i < count; i += chunk_size)
+    {
+        ID3D12Device_CopyDescriptorsSimple(device, chunk_size, dst, src, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        dst.ptr += stride * chunk_size;
+        src.ptr += stride * chunk_size;
+    }
+}
+
 static void zero_descriptor_heap(ID3D12Device *device, ID3D12DescriptorHeap *heap,
         ID3D12Resource *resource, unsigned int count)
 {
@@ -155,7 +173,8 @@ static void do_benchmark_run(ID3D12Device *device)
         start_time = get_time();
         copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
         end_time = get_time();
-        printf("Copying 1M SRVs to dirty GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        printf("Copying 1M SRVs to dirty GPU visible heap took: %.3f ms (%.3f Mcopies/s).\n", 1e3 * (end_time - start_time),
+                1e-6 * 1000000 / (end_time - start_time));
     }
 
     /* Try copying descriptors with duplication */
@@ -163,7 +182,8 @@ static void do_benchmark_run(ID3D12Device *device)
         start_time = get_time();
         copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
         end_time = get_time();
-        printf("Copying 1M SRVs (duplicates) took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        printf("Copying 1M SRVs (duplicates) took: %.3f ms (%.3f Mcopies/s).\n", 1e3 * (end_time - start_time),
+                1e-6 * 1000000 / (end_time - start_time));
     }
 
     /* Create zero descriptors. */
@@ -179,7 +199,18 @@ static void do_benchmark_run(ID3D12Device *device)
         start_time = get_time();
         copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
         end_time = get_time();
-        printf("Copying 1M SRVs to zeroed GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        printf("Copying 1M SRVs to zeroed GPU visible heap took: %.3f ms (%.3f Mcopies/s).\n", 1e3 * (end_time - start_time),
+                1e-6 * 1000000 / (end_time - start_time));
+    }
+
+    /* Typical per-draw table updates, many small CopyDescriptorsSimple calls. */
+    {
+        zero_descriptor_heap(device, gpu_heap, texture, 1000000);
+        start_time = get_time();
+        copy_descriptor_heap_chunked(device, gpu_heap, cpu_heap, 1000000, 16);
+        end_time = get_time();
+        printf("Copying 1M SRVs in chunks of 16 took: %.3f ms (%.3f Mcopies/s).\n", 1e3 * (end_time - start_time),
+                1e-6 * 1000000 / (end_time - start_time));
     }
 
     ID3D12Resource_Release(texture);
@@ -187,6 +218,93 @@ static void do_benchmark_run(ID3D12Device *device)
     ID3D12DescriptorHeap_Release(gpu_heap);
 }
 
+#define SRV_THREAD_VIEW_COUNT 100000
+#define SRV_MAX_THREAD_COUNT 16
+
+struct srv_thread_data
+{
+    ID3D12Device *device;
+    ID3D12DescriptorHeap *heap;
+    ID3D12Resource *resource;
+    const D3D12_SHADER_RESOURCE_VIEW_DESC *desc;
+    unsigned int thread_index;
+};
+
+static void create_srvs_thread_main(void *untyped_data)
+{
+    struct srv_thread_data *data = untyped_data;
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    UINT stride, i;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(data->device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(data->heap);
+    cpu_handle.ptr += stride * SRV_THREAD_VIEW_COUNT * data->thread_index;
+
+    for (i = 0; i < SRV_THREAD_VIEW_COUNT; i++)
+    {
+        ID3D12Device_CreateShaderResourceView(data->device, data->resource, data->desc, cpu_handle);
+        cpu_handle.ptr += stride;
+    }
+}
+
+static void do_threaded_benchmark_run(ID3D12Device *device)
+{
+    struct srv_thread_data data[SRV_MAX_THREAD_COUNT];
+    HANDLE threads[SRV_MAX_THREAD_COUNT];
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_DESCRIPTOR_HEAP_DESC heap_desc;
+    unsigned int thread_count, i;
+    double start_time, end_time;
+    ID3D12DescriptorHeap *heap;
+    ID3D12Resource *texture;
+    HRESULT hr;
+
+    heap_desc.NumDescriptors = SRV_THREAD_VIEW_COUNT * SRV_MAX_THREAD_COUNT;
+    heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heap_desc.NodeMask = 0;
+    hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void**)&heap);
+    ok(SUCCEEDED(hr), "Failed to create descriptor heap, hr #%x.\n", hr);
+
+    texture = create_default_texture2d(device,
+                                       256, 256, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM,
+                                       D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    ok(texture != NULL, "Failed to create texture.\n");
+
+    srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Texture2D.MipLevels = 1;
+    srv_desc.Texture2D.MostDetailedMip = 0;
+    srv_desc.Texture2D.PlaneSlice = 0;
+    srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+    /* All threads create the same view of one resource, which stresses the view map lookup. */
+    for (thread_count = 1; thread_count <= SRV_MAX_THREAD_COUNT; thread_count *= 2)
+    {
+        start_time = get_time();
+        for (i = 0; i < thread_count; i++)
+        {
+            data[i].device = device;
+            data[i].heap = heap;
+            data[i].resource = texture;
+            data[i].desc = &srv_desc;
+            data[i].thread_index = i;
+            threads[i] = create_thread(create_srvs_thread_main, &data[i]);
+        }
+        for (i = 0; i < thread_count; i++)
+            ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+        end_time = get_time();
+
+        printf("Creating %u SRVs of the same resource on %u threads took: %.3f ms (%.3f Mviews/s).\n",
+                SRV_THREAD_VIEW_COUNT * thread_count, thread_count, 1e3 * (end_time - start_time),
+                1e-6 * SRV_THREAD_VIEW_COUNT * thread_count / (end_time - start_time));
+    }
+
+    ID3D12Resource_Release(texture);
+    ID3D12DescriptorHeap_Release(heap);
+}
+
 START_TEST(descriptor_performance)
 {
     ID3D12Device *device;
@@ -199,6 +317,8 @@ START_TEST(descriptor_performance)
     for (i = 0; i < 100; i++)
         do_benchmark_run(device);
 
+    do_threaded_benchmark_run(device);
+
     ID3D12Device_Release(device);
 }
 
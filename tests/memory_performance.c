@@ -0,0 +1,259 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "d3d12_crosstest.h"
+
+PFN_D3D12_CREATE_DEVICE pfn_D3D12CreateDevice;
+PFN_D3D12_ENABLE_EXPERIMENTAL_FEATURES pfn_D3D12EnableExperimentalFeatures;
+PFN_D3D12_GET_DEBUG_INTERFACE pfn_D3D12GetDebugInterface;
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static double get_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER lc, lf;
+    QueryPerformanceCounter(&lc);
+    QueryPerformanceFrequency(&lf);
+    return (double)lc.QuadPart / (double)lf.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+#define TRACE_SLOT_COUNT 2048
+#define TRACE_OPERATION_COUNT 200000
+#define TRACE_WINDOW_SIZE 50000
+#define TRACE_MAX_THREAD_COUNT 16
+#define TRACE_THREAD_SLOT_COUNT 256
+#define TRACE_THREAD_OPERATION_COUNT 20000
+/* Matches the granularity at which vkd3d suballocates committed resources */
+#define TRACE_CHUNK_SIZE (16u << 20)
+
+struct trace_slot
+{
+    ID3D12Resource *resource;
+    UINT64 size;
+};
+
+static uint32_t trace_random(uint32_t *state)
+{
+    /* Deterministic so that runs are comparable */
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static UINT64 trace_random_size(uint32_t *state)
+{
+    uint32_t r = trace_random(state);
+
+    /* Mostly small constant and structured buffers, with
+     * a tail of larger buffers up to just below 1 MiB. */
+    switch (r % 8)
+    {
+        case 0: case 1: case 2:
+            return 256 * (1 + (r >> 3) % 16);
+        case 3: case 4:
+            return 4096 * (1 + (r >> 3) % 16);
+        case 5: case 6:
+            return 65536 * (1 + (r >> 3) % 4);
+        default:
+            return 65536 * (4 + (r >> 3) % 11);
+    }
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+    UINT64 va = *(const UINT64 *)a, vb = *(const UINT64 *)b;
+    return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+static void report_utilization(const struct trace_slot *slots, unsigned int slot_count)
+{
+    UINT64 *chunks, live_size = 0;
+    unsigned int i, chunk_count = 0, live_count = 0;
+
+    /* Resources which end up in the same 16 MiB VA window are very likely
+     * to share a chunk, so the number of distinct windows approximates the
+     * number of chunks needed to back the live set. */
+    chunks = malloc(slot_count * sizeof(*chunks));
+
+    for (i = 0; i < slot_count; i++)
+    {
+        if (!slots[i].resource)
+            continue;
+
+        chunks[live_count++] = ID3D12Resource_GetGPUVirtualAddress(slots[i].resource) / TRACE_CHUNK_SIZE;
+        live_size += slots[i].size;
+    }
+
+    qsort(chunks, live_count, sizeof(*chunks), compare_uint64);
+
+    for (i = 0; i < live_count; i++)
+    {
+        if (!i || chunks[i] != chunks[i - 1])
+            chunk_count++;
+    }
+
+    printf("  %u live resources, %.3f MiB in %u chunk-sized windows (%.1f %% utilization).\n",
+            live_count, live_size / (1024.0 * 1024.0), chunk_count,
+            chunk_count ? 100.0 * live_size / ((double)chunk_count * TRACE_CHUNK_SIZE) : 0.0);
+
+    free(chunks);
+}
+
+static void do_benchmark_run(ID3D12Device *device)
+{
+    struct trace_slot slots[TRACE_SLOT_COUNT];
+    unsigned int i, slot_index, window;
+    unsigned int create_count = 0;
+    double start_time, end_time;
+    uint32_t state = 1;
+
+    memset(slots, 0, sizeof(slots));
+
+    for (window = 0; window < TRACE_OPERATION_COUNT / TRACE_WINDOW_SIZE; window++)
+    {
+        start_time = get_time();
+        for (i = 0; i < TRACE_WINDOW_SIZE; i++)
+        {
+            slot_index = trace_random(&state) % TRACE_SLOT_COUNT;
+
+            if (slots[slot_index].resource)
+            {
+                ID3D12Resource_Release(slots[slot_index].resource);
+                slots[slot_index].resource = NULL;
+            }
+            else
+            {
+                slots[slot_index].size = trace_random_size(&state);
+                slots[slot_index].resource = create_default_buffer(device, slots[slot_index].size,
+                        D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON);
+                create_count++;
+            }
+        }
+        end_time = get_time();
+
+        printf("Trace window %u: %u create/destroy operations took %.3f ms (%.3f us / op).\n",
+                window, TRACE_WINDOW_SIZE, 1e3 * (end_time - start_time),
+                1e6 * (end_time - start_time) / TRACE_WINDOW_SIZE);
+        report_utilization(slots, TRACE_SLOT_COUNT);
+    }
+
+    for (i = 0; i < TRACE_SLOT_COUNT; i++)
+    {
+        if (slots[i].resource)
+            ID3D12Resource_Release(slots[i].resource);
+    }
+
+    printf("Replayed %u operations with %u resource creations.\n", TRACE_OPERATION_COUNT, create_count);
+}
+
+struct trace_thread_data
+{
+    ID3D12Device *device;
+    uint32_t seed;
+};
+
+static void trace_thread_main(void *untyped_data)
+{
+    struct trace_slot slots[TRACE_THREAD_SLOT_COUNT];
+    struct trace_thread_data *data = untyped_data;
+    uint32_t state = data->seed;
+    unsigned int i, slot_index;
+
+    memset(slots, 0, sizeof(slots));
+
+    for (i = 0; i < TRACE_THREAD_OPERATION_COUNT; i++)
+    {
+        slot_index = trace_random(&state) % TRACE_THREAD_SLOT_COUNT;
+
+        if (slots[slot_index].resource)
+        {
+            ID3D12Resource_Release(slots[slot_index].resource);
+            slots[slot_index].resource = NULL;
+        }
+        else
+        {
+            slots[slot_index].size = trace_random_size(&state);
+            slots[slot_index].resource = create_default_buffer(data->device, slots[slot_index].size,
+                    D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON);
+        }
+    }
+
+    for (i = 0; i < TRACE_THREAD_SLOT_COUNT; i++)
+    {
+        if (slots[i].resource)
+            ID3D12Resource_Release(slots[i].resource);
+    }
+}
+
+static void do_threaded_benchmark_run(ID3D12Device *device, unsigned int thread_count)
+{
+    struct trace_thread_data data[TRACE_MAX_THREAD_COUNT];
+    HANDLE threads[TRACE_MAX_THREAD_COUNT];
+    double start_time, end_time;
+    unsigned int i;
+
+    for (i = 0; i < thread_count; i++)
+    {
+        data[i].device = device;
+        data[i].seed = i + 1;
+    }
+
+    start_time = get_time();
+    for (i = 0; i < thread_count; i++)
+        threads[i] = create_thread(trace_thread_main, &data[i]);
+    for (i = 0; i < thread_count; i++)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+    end_time = get_time();
+
+    printf("Replaying %u create/destroy operations on %u threads took %.3f ms (%.3f Mops/s).\n",
+            TRACE_THREAD_OPERATION_COUNT * thread_count, thread_count, 1e3 * (end_time - start_time),
+            1e-6 * TRACE_THREAD_OPERATION_COUNT * thread_count / (end_time - start_time));
+}
+
+START_TEST(memory_performance)
+{
+    unsigned int thread_count;
+    ID3D12Device *device;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+    if (!device)
+        return;
+
+    do_benchmark_run(device);
+
+    for (thread_count = 1; thread_count <= TRACE_MAX_THREAD_COUNT; thread_count *= 2)
+        do_threaded_benchmark_run(device, thread_count);
+
+    ID3D12Device_Release(device);
+}
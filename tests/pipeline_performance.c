@@ -0,0 +1,191 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "d3d12_crosstest.h"
+
+PFN_D3D12_CREATE_DEVICE pfn_D3D12CreateDevice;
+PFN_D3D12_ENABLE_EXPERIMENTAL_FEATURES pfn_D3D12EnableExperimentalFeatures;
+PFN_D3D12_GET_DEBUG_INTERFACE pfn_D3D12GetDebugInterface;
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static double get_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER lc, lf;
+    QueryPerformanceCounter(&lc);
+    QueryPerformanceFrequency(&lf);
+    return (double)lc.QuadPart / (double)lf.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+#define PIPELINE_VARIANT_STRIDE_COUNT 16
+#define PIPELINE_DRAW_COUNT 100000
+#define PIPELINE_MAX_THREAD_COUNT 16
+
+struct draw_thread_data
+{
+    ID3D12Device *device;
+    ID3D12PipelineState *pipeline_state;
+    ID3D12RootSignature *root_signature;
+    ID3D12Resource *vertex_buffer;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+    unsigned int draw_count;
+};
+
+static void record_draws_thread_main(void *untyped_data)
+{
+    struct draw_thread_data *data = untyped_data;
+    ID3D12GraphicsCommandList *command_list;
+    ID3D12CommandAllocator *allocator;
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    D3D12_VIEWPORT viewport;
+    RECT scissor_rect;
+    unsigned int i;
+    HRESULT hr;
+
+    hr = ID3D12Device_CreateCommandAllocator(data->device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(data->device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&command_list);
+    ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+
+    set_viewport(&viewport, 0.0f, 0.0f, 32.0f, 32.0f, 0.0f, 1.0f);
+    set_rect(&scissor_rect, 0, 0, 32, 32);
+
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &data->rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, data->root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, data->pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &viewport);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+
+    vbv.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(data->vertex_buffer);
+    vbv.SizeInBytes = 64 * 1024;
+
+    for (i = 0; i < data->draw_count; i++)
+    {
+        /* All strides are below the minimum dynamic stride of the input layout,
+         * so every draw has to go through the fallback variant lookup. */
+        vbv.StrideInBytes = 16 * (1 + (i % PIPELINE_VARIANT_STRIDE_COUNT));
+        ID3D12GraphicsCommandList_IASetVertexBuffers(command_list, 0, 1, &vbv);
+        ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    }
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(SUCCEEDED(hr), "Failed to close command list, hr %#x.\n", hr);
+
+    ID3D12GraphicsCommandList_Release(command_list);
+    ID3D12CommandAllocator_Release(allocator);
+}
+
+static void do_benchmark_run(struct test_context *context, ID3D12PipelineState *pipeline_state,
+        ID3D12Resource *vertex_buffer, unsigned int thread_count)
+{
+    struct draw_thread_data data;
+    HANDLE threads[PIPELINE_MAX_THREAD_COUNT];
+    double start_time, end_time;
+    unsigned int i;
+
+    data.device = context->device;
+    data.pipeline_state = pipeline_state;
+    data.root_signature = context->root_signature;
+    data.vertex_buffer = vertex_buffer;
+    data.rtv = context->rtv;
+    data.draw_count = PIPELINE_DRAW_COUNT;
+
+    start_time = get_time();
+    for (i = 0; i < thread_count; i++)
+        threads[i] = create_thread(record_draws_thread_main, &data);
+    for (i = 0; i < thread_count; i++)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+    end_time = get_time();
+
+    printf("Recording %u draws with %u variants on %u threads took: %.3f ms (%.3f Mdraws/s).\n",
+            PIPELINE_DRAW_COUNT * thread_count, PIPELINE_VARIANT_STRIDE_COUNT, thread_count,
+            1e3 * (end_time - start_time),
+            1e-6 * PIPELINE_DRAW_COUNT * thread_count / (end_time - start_time));
+}
+
+START_TEST(pipeline_performance)
+{
+    ID3D12PipelineState *pipeline_state;
+    struct test_context_desc desc;
+    struct test_context context;
+    D3D12_INPUT_LAYOUT_DESC input_layout;
+    D3D12_SHADER_BYTECODE vs;
+    ID3D12Resource *vertex_buffer;
+    unsigned int thread_count;
+
+    static const DWORD vs_code[] =
+    {
+#if 0
+        float4 main(float4 pos : POS) : SV_POSITION {
+                return pos;
+        }
+#endif
+        0x43425844, 0xd0f999d3, 0x5250b8b9, 0x32f55488, 0x0498c795, 0x00000001, 0x000000d4, 0x00000003,
+        0x0000002c, 0x00000058, 0x0000008c, 0x4e475349, 0x00000024, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x00000f0f, 0x00534f50, 0x4e47534f, 0x0000002c,
+        0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f,
+        0x505f5653, 0x5449534f, 0x004e4f49, 0x58454853, 0x00000040, 0x00010050, 0x00000010, 0x0100086a,
+        0x0300005f, 0x001010f2, 0x00000000, 0x04000067, 0x001020f2, 0x00000000, 0x00000001, 0x05000036,
+        0x001020f2, 0x00000000, 0x00101e46, 0x00000000, 0x0100003e,
+    };
+
+    static const D3D12_INPUT_ELEMENT_DESC layout_desc[] =
+    {
+        {"POS", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 512, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    };
+
+    setup(argc, argv);
+
+    memset(&desc, 0, sizeof(desc));
+    desc.root_signature_flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+
+    vs = shader_bytecode(vs_code, sizeof(vs_code));
+    input_layout.pInputElementDescs = layout_desc;
+    input_layout.NumElements = ARRAY_SIZE(layout_desc);
+    pipeline_state = create_pipeline_state(context.device, context.root_signature,
+            context.render_target_desc.Format, &vs, NULL, &input_layout);
+    vertex_buffer = create_upload_buffer(context.device, 64 * 1024, NULL);
+
+    for (thread_count = 1; thread_count <= PIPELINE_MAX_THREAD_COUNT; thread_count *= 2)
+        do_benchmark_run(&context, pipeline_state, vertex_buffer, thread_count);
+
+    ID3D12Resource_Release(vertex_buffer);
+    ID3D12PipelineState_Release(pipeline_state);
+    destroy_test_context(&context);
+}
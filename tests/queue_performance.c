@@ -0,0 +1,155 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "d3d12_crosstest.h"
+
+PFN_D3D12_CREATE_DEVICE pfn_D3D12CreateDevice;
+PFN_D3D12_ENABLE_EXPERIMENTAL_FEATURES pfn_D3D12EnableExperimentalFeatures;
+PFN_D3D12_GET_DEBUG_INTERFACE pfn_D3D12GetDebugInterface;
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static double get_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER lc, lf;
+    QueryPerformanceCounter(&lc);
+    QueryPerformanceFrequency(&lf);
+    return (double)lc.QuadPart / (double)lf.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+#define SUBMIT_ITERATION_COUNT 20000
+#define SUBMIT_MAX_THREAD_COUNT 8
+
+struct submit_thread_data
+{
+    ID3D12CommandQueue *queue;
+    ID3D12GraphicsCommandList *command_list;
+    ID3D12Fence *fence;
+    unsigned int iteration_count;
+    double submit_time;
+};
+
+static void submit_thread_main(void *untyped_data)
+{
+    struct submit_thread_data *data = untyped_data;
+    ID3D12CommandList *command_list;
+    double start_time;
+    unsigned int i;
+
+    command_list = (ID3D12CommandList *)data->command_list;
+
+    start_time = get_time();
+    for (i = 0; i < data->iteration_count; i++)
+    {
+        ID3D12CommandQueue_ExecuteCommandLists(data->queue, 1, &command_list);
+        ID3D12CommandQueue_Signal(data->queue, data->fence, i + 1);
+    }
+    data->submit_time = get_time() - start_time;
+}
+
+static void do_benchmark_run(ID3D12Device *device, ID3D12CommandQueue *queue, unsigned int thread_count)
+{
+    struct submit_thread_data data[SUBMIT_MAX_THREAD_COUNT];
+    HANDLE threads[SUBMIT_MAX_THREAD_COUNT];
+    ID3D12CommandAllocator *allocator;
+    double start_time, end_time;
+    double max_submit_time = 0.0;
+    unsigned int i;
+    HRESULT hr;
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        data[i].queue = queue;
+        data[i].iteration_count = SUBMIT_ITERATION_COUNT;
+
+        hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&data[i].command_list);
+        ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+        hr = ID3D12GraphicsCommandList_Close(data[i].command_list);
+        ok(SUCCEEDED(hr), "Failed to close command list, hr %#x.\n", hr);
+
+        hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE,
+                &IID_ID3D12Fence, (void **)&data[i].fence);
+        ok(SUCCEEDED(hr), "Failed to create fence, hr %#x.\n", hr);
+    }
+
+    start_time = get_time();
+    for (i = 0; i < thread_count; i++)
+        threads[i] = create_thread(submit_thread_main, &data[i]);
+    for (i = 0; i < thread_count; i++)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+    for (i = 0; i < thread_count; i++)
+        wait_for_fence(data[i].fence, SUBMIT_ITERATION_COUNT);
+    end_time = get_time();
+
+    for (i = 0; i < thread_count; i++)
+        max_submit_time = max(max_submit_time, data[i].submit_time);
+
+    printf("Submitting %u ExecuteCommandLists + Signal pairs on %u threads: "
+            "producer %.3f us / submission, total %.3f ms.\n",
+            SUBMIT_ITERATION_COUNT * thread_count, thread_count,
+            1e6 * max_submit_time / SUBMIT_ITERATION_COUNT,
+            1e3 * (end_time - start_time));
+
+    for (i = 0; i < thread_count; i++)
+    {
+        ID3D12Fence_Release(data[i].fence);
+        ID3D12GraphicsCommandList_Release(data[i].command_list);
+    }
+    ID3D12CommandAllocator_Release(allocator);
+}
+
+START_TEST(queue_performance)
+{
+    ID3D12CommandQueue *queue;
+    unsigned int thread_count;
+    ID3D12Device *device;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+    if (!device)
+        return;
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    for (thread_count = 1; thread_count <= SUBMIT_MAX_THREAD_COUNT; thread_count *= 2)
+        do_benchmark_run(device, queue, thread_count);
+
+    ID3D12CommandQueue_Release(queue);
+    ID3D12Device_Release(device);
+}
@@ -16,11 +16,42 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
 #include "vkd3d_test.h"
 #include <vkd3d_shader.h>
 
 #include <locale.h>
 
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const DWORD vs_code[] =
+{
+#if 0
+    float4 main(int4 p : POSITION) : SV_Position
+    {
+        return p;
+    }
+#endif
+    0x43425844, 0x3fd50ab1, 0x580a1d14, 0x28f5f602, 0xd1083e3a, 0x00000001, 0x000000d8, 0x00000003,
+    0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+    0x00000000, 0x00000000, 0x00000002, 0x00000000, 0x00000f0f, 0x49534f50, 0x4e4f4954, 0xababab00,
+    0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000001, 0x00000003,
+    0x00000000, 0x0000000f, 0x505f5653, 0x7469736f, 0x006e6f69, 0x52444853, 0x0000003c, 0x00010040,
+    0x0000000f, 0x0300005f, 0x001010f2, 0x00000000, 0x04000067, 0x001020f2, 0x00000000, 0x00000001,
+    0x0500002b, 0x001020f2, 0x00000000, 0x00101e46, 0x00000000, 0x0100003e,
+};
+static const struct vkd3d_shader_code vs = {vs_code, sizeof(vs_code)};
+
+static const struct vkd3d_shader_interface_info vs_interface =
+{
+    .stage = VK_SHADER_STAGE_VERTEX_BIT,
+};
+
 static void test_invalid_shaders(void)
 {
     struct vkd3d_shader_code spirv;
@@ -49,8 +80,12 @@ static void test_invalid_shaders(void)
         0x00004002, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x0100003e,
     };
     static const struct vkd3d_shader_code ps_break = {ps_break_code, sizeof(ps_break_code)};
+    static const struct vkd3d_shader_interface_info ps_interface =
+    {
+        .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
 
-    rc = vkd3d_shader_compile_dxbc(&ps_break, &spirv, VKD3D_SHADER_STRIP_DEBUG, NULL, NULL);
+    rc = vkd3d_shader_compile_dxbc(&ps_break, &spirv, VKD3D_SHADER_STRIP_DEBUG, &ps_interface, NULL);
     ok(rc == VKD3D_ERROR_INVALID_SHADER, "Got unexpected error code %d.\n", rc);
 }
 
@@ -77,23 +112,6 @@ static void test_vkd3d_shader_pfns(void)
     {
         .version = VKD3D_ROOT_SIGNATURE_VERSION_1_0,
     };
-    static const DWORD vs_code[] =
-    {
-#if 0
-        float4 main(int4 p : POSITION) : SV_Position
-        {
-            return p;
-        }
-#endif
-        0x43425844, 0x3fd50ab1, 0x580a1d14, 0x28f5f602, 0xd1083e3a, 0x00000001, 0x000000d8, 0x00000003,
-        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
-        0x00000000, 0x00000000, 0x00000002, 0x00000000, 0x00000f0f, 0x49534f50, 0x4e4f4954, 0xababab00,
-        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000001, 0x00000003,
-        0x00000000, 0x0000000f, 0x505f5653, 0x7469736f, 0x006e6f69, 0x52444853, 0x0000003c, 0x00010040,
-        0x0000000f, 0x0300005f, 0x001010f2, 0x00000000, 0x04000067, 0x001020f2, 0x00000000, 0x00000001,
-        0x0500002b, 0x001020f2, 0x00000000, 0x00101e46, 0x00000000, 0x0100003e,
-    };
-    static const struct vkd3d_shader_code vs = {vs_code, sizeof(vs_code)};
 
     pfn_vkd3d_shader_serialize_root_signature = vkd3d_shader_serialize_root_signature;
     pfn_vkd3d_shader_find_signature_element = vkd3d_shader_find_signature_element;
@@ -118,7 +136,7 @@ static void test_vkd3d_shader_pfns(void)
     ok(element, "Could not find shader signature element.\n");
     pfn_vkd3d_shader_free_shader_signature(&signature);
 
-    rc = pfn_vkd3d_shader_compile_dxbc(&vs, &spirv, 0, NULL, NULL);
+    rc = pfn_vkd3d_shader_compile_dxbc(&vs, &spirv, 0, &vs_interface, NULL);
     ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
     pfn_vkd3d_shader_free_shader_code(&spirv);
 
@@ -127,10 +145,177 @@ static void test_vkd3d_shader_pfns(void)
     ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
 }
 
+static void test_shader_hash(void)
+{
+    struct vkd3d_shader_code spirv;
+    int rc;
+
+    /* Version 2 of the hash is XXH64 of the DXBC blob with a zero seed. */
+    rc = vkd3d_shader_compile_dxbc(&vs, &spirv, 0, &vs_interface, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    ok(spirv.meta.hash == 0x4bac8c287077bf1eull, "Got unexpected hash %016"PRIx64".\n", spirv.meta.hash);
+    vkd3d_shader_free_shader_code(&spirv);
+}
+
+#ifndef _WIN32
+static unsigned int get_shader_cache_entries(const char *dir, char *entry, size_t entry_size)
+{
+    unsigned int count = 0;
+    struct dirent *d;
+    size_t len;
+    DIR *dp;
+
+    if (!(dp = opendir(dir)))
+        return 0;
+
+    while ((d = readdir(dp)))
+    {
+        len = strlen(d->d_name);
+        if (len < 9 || strcmp(d->d_name + len - 9, ".spvcache"))
+            continue;
+        if (!count++ && entry)
+            snprintf(entry, entry_size, "%s/%s", dir, d->d_name);
+    }
+
+    closedir(dp);
+    return count;
+}
+
+static void remove_shader_cache(const char *dir)
+{
+    char path[1024];
+    struct dirent *d;
+    DIR *dp;
+
+    if ((dp = opendir(dir)))
+    {
+        while ((d = readdir(dp)))
+        {
+            if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, ".."))
+                continue;
+            snprintf(path, sizeof(path), "%s/%s", dir, d->d_name);
+            remove(path);
+        }
+        closedir(dp);
+    }
+
+    rmdir(dir);
+}
+
+/* Returns whether the SPIR-V matches the reference, if there is one. */
+static bool compile_vs(const struct vkd3d_shader_interface_info *interface_info,
+        const struct vkd3d_shader_compile_arguments *compile_args, const struct vkd3d_shader_code *reference)
+{
+    struct vkd3d_shader_code spirv;
+    bool equal;
+    int rc;
+
+    rc = vkd3d_shader_compile_dxbc(&vs, &spirv, 0, interface_info, compile_args);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        return false;
+
+    equal = !reference || (spirv.size == reference->size && !memcmp(spirv.code, reference->code, spirv.size));
+    vkd3d_shader_free_shader_code(&spirv);
+    return equal;
+}
+#endif
+
+static void test_shader_cache(void)
+{
+#ifdef _WIN32
+    skip("The shader cache test is not implemented on Windows.\n");
+#else
+    struct vkd3d_shader_interface_info interface_info;
+    struct vkd3d_shader_compile_arguments compile_args;
+    struct vkd3d_shader_code spirv;
+    char dir[256], entry[1024];
+    struct stat st, new_st;
+    const char *tmp_dir;
+    unsigned int count;
+    uint8_t byte;
+    FILE *f;
+    int rc;
+
+    if (!(tmp_dir = getenv("TMPDIR")))
+        tmp_dir = "/tmp";
+    snprintf(dir, sizeof(dir), "%s/vkd3d-shader-cache-XXXXXX", tmp_dir);
+    if (!mkdtemp(dir))
+    {
+        skip("Failed to create temporary directory.\n");
+        return;
+    }
+
+    /* The cache path is only read once, so this must run before anything else compiles a shader. */
+    setenv("VKD3D_SHADER_CACHE_PATH", dir, 1);
+
+    rc = vkd3d_shader_compile_dxbc(&vs, &spirv, 0, &vs_interface, NULL);
+    ok(rc == VKD3D_OK, "Got unexpected error code %d.\n", rc);
+    if (rc != VKD3D_OK)
+        goto done;
+
+    count = get_shader_cache_entries(dir, entry, sizeof(entry));
+    ok(count == 1, "Got unexpected entry count %u.\n", count);
+    if (count != 1 || stat(entry, &st))
+        goto done;
+
+    /* A hit must not write the entry again. */
+    ok(compile_vs(&vs_interface, NULL, &spirv), "Got unexpected SPIR-V from cache hit.\n");
+    ok(!stat(entry, &new_st) && new_st.st_ino == st.st_ino, "Cache entry was rewritten on a hit.\n");
+    count = get_shader_cache_entries(dir, NULL, 0);
+    ok(count == 1, "Got unexpected entry count %u.\n", count);
+
+    /* The shader interface and compile arguments are part of the key. */
+    interface_info = vs_interface;
+    interface_info.min_ssbo_alignment = 16;
+    compile_vs(&interface_info, NULL, NULL);
+    count = get_shader_cache_entries(dir, NULL, 0);
+    ok(count == 2, "Got unexpected entry count %u.\n", count);
+
+    memset(&compile_args, 0, sizeof(compile_args));
+    compile_args.target = VKD3D_SHADER_TARGET_SPIRV_VULKAN_1_0;
+    compile_args.dual_source_blending = true;
+    compile_vs(&vs_interface, &compile_args, NULL);
+    count = get_shader_cache_entries(dir, NULL, 0);
+    ok(count == 3, "Got unexpected entry count %u.\n", count);
+
+    /* Truncated entries are rejected and replaced. */
+    ok(!truncate(entry, st.st_size / 2), "Failed to truncate %s.\n", entry);
+    ok(compile_vs(&vs_interface, NULL, &spirv), "Got unexpected SPIR-V after truncation.\n");
+    ok(!stat(entry, &new_st) && new_st.st_size == st.st_size, "Truncated cache entry was not replaced.\n");
+
+    /* So are entries with a corrupt payload. */
+    f = fopen(entry, "r+b");
+    ok(!!f, "Failed to open %s.\n", entry);
+    if (!f)
+        goto done;
+    fseek(f, -1, SEEK_END);
+    byte = fgetc(f);
+    fseek(f, -1, SEEK_END);
+    fputc(byte ^ 0xff, f);
+    fclose(f);
+
+    ok(compile_vs(&vs_interface, NULL, &spirv), "Got unexpected SPIR-V after corruption.\n");
+    if ((f = fopen(entry, "rb")))
+    {
+        fseek(f, -1, SEEK_END);
+        ok(fgetc(f) == byte, "Corrupt cache entry was not replaced.\n");
+        fclose(f);
+    }
+
+done:
+    if (rc == VKD3D_OK)
+        vkd3d_shader_free_shader_code(&spirv);
+    remove_shader_cache(dir);
+#endif
+}
+
 START_TEST(vkd3d_shader_api)
 {
     setlocale(LC_ALL, "");
 
+    run_test(test_shader_cache);
     run_test(test_invalid_shaders);
     run_test(test_vkd3d_shader_pfns);
+    run_test(test_shader_hash);
 }